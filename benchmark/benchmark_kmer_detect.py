@@ -0,0 +1,62 @@
+import os
+import re
+import subprocess
+from timeit import default_timer as timer
+from path import *
+PWD = os.path.dirname(os.path.realpath(__file__))
+
+# Compare the index-free k-mer detection with the index-based (alignment) detection
+# of single-end mode: detected adapter and wall time, over several adapter
+# contamination levels (insert size mean/deviation).
+READS_NUM = 100000
+INSERT_MEAN = [60, 100, 150]
+INSERT_DEV = 30
+
+IDX_PREFIX = HG38_CHR1_EARRINGS_IDX
+OUTPUT_DIR = os.path.join(PWD, "benchmark_kmer_detect")
+OUTPUT_DATA_DIR = os.path.join(OUTPUT_DIR, "data")
+
+AD1_SIM = "AGATCGGAAGAGCACACGTCTGAACTCCAGTCACCACCTAATCTCGTATGCCGTCTTCTGCTTG"
+AD2_SIM = "AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGTAGATCTCGGTGGTCGCCGTATCATT"
+
+MODES = {"index": "{} single -p {} -1 {} -o {}",
+         "kmer": "{} single --kmer_detect -1 {} -o {}"}
+
+def run_mode(mode, reads, out_prefix):
+    if mode == "index":
+        command = MODES[mode].format(EARRINGS_EXE, IDX_PREFIX, reads, out_prefix)
+    else:
+        command = MODES[mode].format(EARRINGS_EXE, reads, out_prefix)
+    start = timer()
+    out = subprocess.run(command, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT).stdout.decode()
+    end = timer()
+    found = re.findall("adapter found: ([ACGTN]+)", out)
+    return (found[0] if len(found) != 0 else ""), end - start
+
+if __name__ == "__main__":
+    if not os.path.exists(OUTPUT_DATA_DIR):
+        os.makedirs(OUTPUT_DATA_DIR)
+
+    f = open(os.path.join(OUTPUT_DIR, "kmer_detect.tsv"), "w")
+    f.write("insert_mean\tseed\tmode\tcorrect\tseconds\tadapter\n")
+    for mean in INSERT_MEAN:
+        for seed in range(10):
+            simu_fname = "mean_{}_std_{}_seed_{}".format(str(mean), str(INSERT_DEV), str(seed))
+            simu_fpath = os.path.join(OUTPUT_DATA_DIR, simu_fname)
+            simu_log = os.path.join(OUTPUT_DATA_DIR, "{}.log".format(simu_fname))
+            GEN1 = "{}_1.fq".format(simu_fpath)
+            command = "python3 {} {} -r {} -n {} -m {} -std {} -ad1 {} -ad2 {} -q 1 -t 1 -a 1 -o {} -s {} -O {}"\
+                    .format(RUN_SIM_EXE, str(seed), HG38_CHR1_REF, READS_NUM, mean, INSERT_DEV, AD1_SIM, AD2_SIM, simu_log, simu_fname, OUTPUT_DATA_DIR)
+            print(command, flush=True)
+            os.system(command)
+
+            for mode in MODES:
+                adapter, sec = run_mode(mode, GEN1, os.path.join(OUTPUT_DIR, "earrings_{}".format(mode)))
+                correct = len(adapter) != 0 and AD1_SIM.startswith(adapter)
+                f.write("{}\t{}\t{}\t{}\t{:.3f}\t{}\n".format(mean, seed, mode, int(correct), sec, adapter))
+                print(mode, adapter, sec, flush=True)
+
+            for fname in os.listdir(OUTPUT_DATA_DIR):
+                if fname.startswith(simu_fname):
+                    os.remove(os.path.join(OUTPUT_DATA_DIR, fname))
+    f.close()
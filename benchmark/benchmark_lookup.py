@@ -0,0 +1,71 @@
+import os
+import random
+import subprocess
+from timeit import default_timer as timer
+from path import *
+PWD = os.path.dirname(os.path.realpath(__file__))
+
+# Single-end detection time across seed lengths for different lookup table
+# lengths of the index. The lookup length is fixed when EARRINGS is built, so
+# every length needs its own build, configured with
+#   cmake -DTAILOR_LOOKUP_STR_LEN=<len> -B build_lookup_<len>
+# Tables up to 14 bases are dense, longer ones are sparse.
+LOOKUP_LENS = [12, 14, 20, 24]
+LOOKUP_EXES = {k: os.path.join(PWD, "..", "build_lookup_{}".format(k), "EARRINGS") for k in LOOKUP_LENS}
+SEED_LENS = [18, 20, 22, 25, 30, 35, 40, 45, 50]
+READS_NUM = 1000000
+READ_LEN = 100
+THREADS = 8
+REF = HG38_CHR1_REF
+
+OUTPUT_DIR = os.path.join(PWD, "benchmark_lookup")
+OUTPUT_DATA_DIR = os.path.join(OUTPUT_DIR, "data")
+
+AD1_SIM = "AGATCGGAAGAGCACACGTCTGAACTCCAGTCACCACCTAATCTCGTATGCCGTCTTCTGCTTG"
+
+def read_ref(fname):
+    seqs = []
+    with open(fname) as f:
+        for line in f:
+            if not line.startswith(">"):
+                seqs.append(line.strip().upper())
+    return "".join(seqs)
+
+def simulate(rng, ref, fname):
+    # inserts from the reference followed by the adapter, inserts with n-bases are redrawn
+    with open(fname, "w") as f:
+        i = 0
+        while i < READS_NUM:
+            insert = rng.randint(18, READ_LEN)
+            pos = rng.randint(0, len(ref) - insert)
+            frag = ref[pos:pos + insert]
+            if "N" in frag:
+                continue
+            seq = (frag + AD1_SIM * 2)[:READ_LEN]
+            f.write("@read_{}\n{}\n+\n{}\n".format(i, seq, "I" * READ_LEN))
+            i += 1
+
+if __name__ == "__main__":
+    if not os.path.exists(OUTPUT_DATA_DIR):
+        os.makedirs(OUTPUT_DATA_DIR)
+
+    GEN = os.path.join(OUTPUT_DATA_DIR, "reads.fq")
+    simulate(random.Random(0), read_ref(REF), GEN)
+
+    f = open(os.path.join(OUTPUT_DIR, "lookup.tsv"), "w")
+    f.write("lookup_len\tseed_len\tseconds\n")
+    for k in LOOKUP_LENS:
+        idx = os.path.join(OUTPUT_DATA_DIR, "earrings_lookup_{}".format(k))
+        command = "{} build -r {} -p {}".format(LOOKUP_EXES[k], REF, idx)
+        subprocess.run(command, shell=True, stdout=subprocess.DEVNULL)
+
+        for seed_len in SEED_LENS:
+            out_prefix = os.path.join(OUTPUT_DIR, "earrings_se")
+            command = "{} single -p {} -1 {} -o {} -d {} -t {}".format(LOOKUP_EXES[k], idx, GEN, out_prefix, seed_len, THREADS)
+            start = timer()
+            subprocess.run(command, shell=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            end = timer()
+            f.write("{}\t{}\t{:.3f}\n".format(k, seed_len, end - start))
+            print(k, seed_len, end - start, flush=True)
+    f.close()
+    os.remove(GEN)
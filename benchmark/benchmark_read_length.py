@@ -0,0 +1,78 @@
+import os
+import random
+import subprocess
+from timeit import default_timer as timer
+from path import *
+PWD = os.path.dirname(os.path.realpath(__file__))
+
+# Paired-end trimming across read lengths: wall time and the fraction of pairs
+# trimmed to their exact insert size. Reads are simulated here with random
+# inserts, so every read length (including the ones pIRS has no profile for)
+# gets the same adapter contamination, about one third of the pairs.
+READS_NUM = 200000
+READ_LENS = [20, 36, 50, 75, 100, 150, 250, 300]
+THREADS = [1, 8]
+SEEDS = range(3)
+
+OUTPUT_DIR = os.path.join(PWD, "benchmark_read_length")
+OUTPUT_DATA_DIR = os.path.join(OUTPUT_DIR, "data")
+
+AD1_SIM = "AGATCGGAAGAGCACACGTCTGAACTCCAGTCACCACCTAATCTCGTATGCCGTCTTCTGCTTG"
+AD2_SIM = "AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGTAGATCTCGGTGGTCGCCGTATCATT"
+COMP = str.maketrans("ACGT", "TGCA")
+
+def random_seq(rng, n):
+    return "".join(rng.choice("ACGT") for _ in range(n))
+
+def simulate(rng, read_len, fname1, fname2):
+    # insert sizes of each read, by read name
+    inserts = {}
+    with open(fname1, "w") as f1, open(fname2, "w") as f2:
+        for i in range(READS_NUM):
+            insert = rng.randint(read_len // 2, read_len * 2)
+            frag = random_seq(rng, insert)
+            name = "read_{}".format(i)
+            seq1 = (frag + AD1_SIM + random_seq(rng, read_len))[:read_len]
+            seq2 = (frag[::-1].translate(COMP) + AD2_SIM + random_seq(rng, read_len))[:read_len]
+            qual = "I" * read_len
+            f1.write("@{}\n{}\n+\n{}\n".format(name, seq1, qual))
+            f2.write("@{}\n{}\n+\n{}\n".format(name, seq2, qual))
+            inserts[name] = min(insert, read_len)
+    return inserts
+
+def exact_trimmed(fname, inserts):
+    exact = 0
+    with open(fname) as f:
+        for i, line in enumerate(f):
+            if i % 4 == 0:
+                name = line[1:].split()[0]
+            elif i % 4 == 1 and len(line.rstrip("\n")) == inserts[name]:
+                exact += 1
+    return exact / len(inserts)
+
+if __name__ == "__main__":
+    if not os.path.exists(OUTPUT_DATA_DIR):
+        os.makedirs(OUTPUT_DATA_DIR)
+
+    f = open(os.path.join(OUTPUT_DIR, "read_length.tsv"), "w")
+    f.write("read_len\tseed\tthreads\texact\tseconds\n")
+    for read_len in READ_LENS:
+        for seed in SEEDS:
+            rng = random.Random(seed)
+            GEN1 = os.path.join(OUTPUT_DATA_DIR, "len_{}_seed_{}_1.fq".format(read_len, seed))
+            GEN2 = os.path.join(OUTPUT_DATA_DIR, "len_{}_seed_{}_2.fq".format(read_len, seed))
+            inserts = simulate(rng, read_len, GEN1, GEN2)
+
+            for thread in THREADS:
+                out_prefix = os.path.join(OUTPUT_DIR, "earrings_pe")
+                command = "{} paired -1 {} -2 {} -o {} -t {} -m 0".format(EARRINGS_EXE, GEN1, GEN2, out_prefix, thread)
+                start = timer()
+                subprocess.run(command, shell=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+                end = timer()
+                exact = exact_trimmed("{}_1.fastq".format(out_prefix), inserts)
+                f.write("{}\t{}\t{}\t{:.4f}\t{:.3f}\n".format(read_len, seed, thread, exact, end - start))
+                print(read_len, seed, thread, exact, end - start, flush=True)
+
+            os.remove(GEN1)
+            os.remove(GEN2)
+    f.close()
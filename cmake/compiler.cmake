@@ -11,4 +11,5 @@ if("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU")
 else()
     # set(cxx_debug_flag)
 endif()
+add_definitions( -DTAILOR_LOOKUP_STR_LEN=${TAILOR_LOOKUP_STR_LEN} )
 screw_set_debugger()
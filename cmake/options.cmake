@@ -1,4 +1,5 @@
 option( ENABLE_CPACK "Enables cpack rules" ON )
 option( BUILD_SHARED_LIBS "Build shared library" OFF )
 option( BUILD_TESTS "Build tests" ON)
-option( INSTALL_DEPS "Install upstream dependencies" OFF)
\ No newline at end of file
+option( INSTALL_DEPS "Install upstream dependencies" OFF)
+set( TAILOR_LOOKUP_STR_LEN 12 CACHE STRING "Bases of the index lookup table, dense up to 14 and sparse above" )
\ No newline at end of file
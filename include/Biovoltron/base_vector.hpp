@@ -129,6 +129,7 @@ public:
         noexcept(allocator_traits<allocator_type>::propagate_on_container_swap::value ||
                  allocator_traits<allocator_type>::is_always_equal::value);  // C++17
     void flip() noexcept;
+    void reverse_complement() noexcept;
 
     bool __invariants() const;
 
@@ -160,6 +161,9 @@ template <class CharT, class Allocator>
 void swap(vector<CharT,Allocator>& x, vector<CharT,Allocator>& y)
     noexcept(noexcept(x.swap(y)));
 
+template <class Storage>
+void reverse_complement(Storage* first, size_t n) noexcept;
+
 // for value_type = char_type:
 
 template<class CharT, class Allocator> bool operator==(const CharT* lhs, const vector<CharT, Allocator>& rhs) noexcept;
@@ -256,6 +260,56 @@ __vector_base_common<b>::__throw_out_of_range() const
     throw std::out_of_range("vector");
 }
 
+/**
+* @brief reverses and complements n bases packed in the words from first
+*
+* @tparam Storage - unsigned word type holding the 2-bit bases
+*
+* @param first - the first word, base i is at bit 2 * i of the words
+* @param n - the number of bases, which take up the first
+*            (n - 1) / bases per word + 1 words
+*
+* The words are swapped end to end, the bases in a word are reversed by
+* swapping bit pairs, nibbles and bytes, and complemented with a single
+* xor. The unused bases of the last word are then shifted out, which
+* leaves them zero.
+*/
+template <class Storage>
+void
+reverse_complement(Storage* first, size_t n) noexcept
+{
+    static_assert(std::is_unsigned_v<Storage> && sizeof(Storage) == 8);
+    constexpr unsigned bases_per_word = sizeof(Storage) * CHAR_BIT / 2;
+    if (n == 0)
+        return;
+
+    auto rc = [](Storage w)
+    {
+        w = (w >> 2 & 0x3333333333333333) | (w & 0x3333333333333333) << 2;
+        w = (w >> 4 & 0x0F0F0F0F0F0F0F0F) | (w & 0x0F0F0F0F0F0F0F0F) << 4;
+        return __builtin_bswap64(w) ^ ~Storage(0);
+    };
+
+    size_t words = (n - 1) / bases_per_word + 1;
+    Storage* last = first + words;
+    for (Storage *l = first, *r = last - 1; l < r; ++l, --r)
+    {
+        Storage t = rc(*l);
+        *l = rc(*r);
+        *r = t;
+    }
+    if (words % 2 == 1)
+        first[words / 2] = rc(first[words / 2]);
+
+    // the unused bases are now in front of the first word
+    unsigned shift = (words * bases_per_word - n) * 2;
+    if (shift == 0)
+        return;
+    for (Storage* p = first; p + 1 < last; ++p)
+        *p = *p >> shift | p[1] << (sizeof(Storage) * CHAR_BIT - shift);
+    last[-1] >>= shift;
+}
+
 template <class CharT, class Allocator = std::allocator<CharT> >
 class vector : private __vector_base_common<true>
 {
@@ -482,7 +536,9 @@ public:
     static void swap(reference x, reference y) noexcept {biovoltron::swap(x, y);}
 
     void resize(size_type sz, value_type x = 0);
+    void __resize_default_init(size_type sz);
     void flip() noexcept;
+    void reverse_complement() noexcept;
 
     bool __invariants() const;
 
@@ -1647,6 +1703,26 @@ vector<CharT, Allocator>::resize(size_type sz, value_type x)
         size_ = sz;
 }
 
+/**
+* @brief changes the number of elements stored, new elements are left
+* uninitialized
+* 
+* @tparam CharT - char_type or uint_type
+* @tparam Allocator 
+*
+* @param sz - new size of the container
+*
+* For callers that fill the words behind data() directly.
+*/
+template <class CharT, class Allocator>
+void
+vector<CharT, Allocator>::__resize_default_init(size_type sz)
+{
+    if (sz > capacity())
+        reserve(__recommend(sz));
+    size_ = sz;
+}
+
 /**
 * @brief changes the bases to complementary bases
 * 
@@ -1674,6 +1750,21 @@ vector<CharT, Allocator>::flip() noexcept
     }
 }
 
+/**
+* @brief reverses the bases and changes them to complementary bases
+* 
+* @tparam CharT - char_type or uint_type
+* @tparam Allocator 
+*
+* Works on whole words, see biovoltron::reverse_complement().
+*/
+template <class CharT, class Allocator>
+void
+vector<CharT, Allocator>::reverse_complement() noexcept
+{
+    biovoltron::reverse_complement(begin_, size_);
+}
+
 /**
 * @brief changes the bases to complementary bases
 * 
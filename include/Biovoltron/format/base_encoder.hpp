@@ -0,0 +1,233 @@
+/**
+ * @file base_encoder.hpp
+ * @brief 2-bit encoding of sequence lines shared by the format parsers
+ *
+ * @author JHH corp
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <simdpp/simd.h>
+#include <Biovoltron/base_vector.hpp>
+
+namespace biovoltron::format{
+
+/**
+ * @brief Tells whether Sequence is a biovoltron::vector of char_type,
+ * which encode_seq() fills word by word instead of base by base
+ */
+template <typename Sequence>
+struct is_base_vector : std::false_type {};
+
+template <typename Allocator>
+struct is_base_vector<biovoltron::vector<biovoltron::char_type, Allocator>>
+    : std::true_type {};
+
+/**
+ * @class NBaseRand
+ * @brief A xorshift generator of the bases replacing n-bases
+ *
+ * The generator is seeded per entry, so the replacement of an entry
+ * does not depend on which entries were parsed before it, nor on
+ * which thread parsed it.
+ */
+class NBaseRand
+{
+    uint64_t state_;
+
+  public:
+    /**
+     * @brief Seeds the generator with the name of an entry
+     *
+     * @param name The name line of the entry
+     */
+    NBaseRand(const std::string& name)
+	: state_(14695981039346656037ull)
+    {
+	for (auto c : name)
+	    state_ = (state_ ^ uint8_t(c)) * 1099511628211ull;
+	if (state_ == 0)
+	    state_ = 88172645463325252ull;
+    }
+
+    /**
+     * @brief Gets 64 random bits, 2 bits for each of 32 bases
+     */
+    uint64_t operator()() noexcept
+    {
+	state_ ^= state_ << 13;
+	state_ ^= state_ >> 7;
+	state_ ^= state_ << 17;
+	return state_;
+    }
+};
+
+/**
+ * @brief Spreads the 16 bits of x to the even bits of a 32-bit word
+ */
+inline uint32_t spread_bits(uint32_t x) noexcept
+{
+    x = (x | x << 8) & 0x00FF00FF;
+    x = (x | x << 4) & 0x0F0F0F0F;
+    x = (x | x << 2) & 0x33333333;
+    x = (x | x << 1) & 0x55555555;
+    return x;
+}
+
+/**
+ * @brief Encodes a sequence line into 2-bit bases
+ *
+ * @param line The sequence line, A/C/G/T/N in either case
+ * @param seq The Sequence to store the bases
+ * @param n_table Start point and length of every continuous n-base
+ * sub-sequence are appended to it
+ * @param rand The generator of the bases replacing n-bases
+ * @return false if line has any other charactor
+ *
+ * A biovoltron::vector is written a word at a time. 16 charactors are
+ * classified by vector compares, and the 2-bit code of A/C/G/T, which
+ * is ((c >> 1 ^ c >> 2) & 1) | (c >> 1 & 2), is gathered from bit 1
+ * and 2 of the charactors by two bit extractions. n-bases are found
+ * from the compare mask and replaced with random bases in one step.
+ * Other Sequence types take a push_back per base.
+ *
+ * Time complexity: O(n)<br>
+ *	    \e n: the length of sequence<br>
+ */
+template <typename Sequence, typename NTable>
+bool encode_seq(const std::string& line, Sequence& seq, NTable& n_table, NBaseRand& rand)
+{
+    // extend the last run when it ends right before pos
+    auto add_n_base = [&n_table](uint64_t pos)
+    {
+	if (!n_table.empty() &&
+		n_table.back().first + n_table.back().second == pos)
+	    n_table.back().second++;
+	else
+	    n_table.emplace_back(pos, 1);
+    };
+
+    if constexpr (is_base_vector<Sequence>::value)
+    {
+	using SIMD_Vector = simdpp::uint8<16>;
+	constexpr size_t bases_per_word = Sequence::bases_per_word;
+	const SIMD_Vector case_mask = simdpp::make_uint(0xDF)
+			, ones = simdpp::make_uint(0xFF)
+			, zeros = simdpp::make_uint(0)
+			, base_a = simdpp::make_uint('A')
+			, base_c = simdpp::make_uint('C')
+			, base_g = simdpp::make_uint('G')
+			, base_t = simdpp::make_uint('T')
+			, base_n = simdpp::make_uint('N');
+
+	seq.__resize_default_init(line.size());
+	auto words = seq.data();
+	uint64_t word(0);
+	char tail[16];
+	for (size_t i(0); i < line.size(); i += 16)
+	{
+	    // the last chunk is padded with 'A', which is coded as 0
+	    auto len = std::min<size_t>(16, line.size() - i);
+	    auto chunk = line.data() + i;
+	    if (len < 16)
+	    {
+		std::fill(std::copy(chunk, chunk + len, tail), tail + 16, 'A');
+		chunk = tail;
+	    }
+	    uint32_t valid = (1u << len) - 1;
+
+	    SIMD_Vector c = simdpp::load_u(chunk);
+	    SIMD_Vector upper = c & case_mask;
+	    SIMD_Vector is_base = simdpp::blend(ones, zeros,
+		simdpp::cmp_eq(upper, base_a) | simdpp::cmp_eq(upper, base_c) |
+		simdpp::cmp_eq(upper, base_g) | simdpp::cmp_eq(upper, base_t));
+	    SIMD_Vector is_n = simdpp::blend(ones, zeros, simdpp::cmp_eq(upper, base_n));
+	    uint32_t n_bits = simdpp::extract_bits<7>(is_n) & valid;
+	    if ((simdpp::extract_bits<7>(is_base) | n_bits) != 0xFFFF)
+		return false;
+
+	    uint32_t lo = simdpp::extract_bits<7>((c << 6) ^ (c << 5));
+	    uint32_t hi = simdpp::extract_bits<7>(c << 5);
+	    uint64_t codes = spread_bits(lo) | spread_bits(hi) << 1;
+	    if (n_bits != 0)
+	    {
+		uint64_t n_mask = uint64_t(spread_bits(n_bits)) * 3;
+		codes = (codes & ~n_mask) | (rand() & n_mask);
+		for (auto bits = n_bits; bits != 0; bits &= bits - 1)
+		    add_n_base(i + __builtin_ctz(bits));
+	    }
+	    codes &= (uint64_t(1) << (2 * len)) - 1;
+
+	    word |= codes << (2 * (i % bases_per_word));
+	    if ((i + 16) % bases_per_word == 0 || i + 16 >= line.size())
+	    {
+		*words++ = word;
+		word = 0;
+	    }
+	}
+    }
+    else
+    {
+	seq.reserve(line.size());
+	uint64_t bits(0), n_cnt(0);
+	for (size_t i(0); i < line.size(); i++)
+	{
+	    switch (line[i])
+	    {
+		case 'A': case 'a': seq.push_back('A'); break;
+		case 'C': case 'c': seq.push_back('C'); break;
+		case 'G': case 'g': seq.push_back('G'); break;
+		case 'T': case 't': seq.push_back('T'); break;
+		case 'N': case 'n':
+		    if (n_cnt++ % 32 == 0)
+			bits = rand();
+		    seq.push_back(biovoltron::to_char_type(bits & 3));
+		    bits >>= 2;
+		    add_n_base(i);
+		    break;
+		default:
+		    return false;
+	    }
+	}
+    }
+
+    return true;
+}
+
+/**
+ * @brief Tells whether every quality charactor is within '!' to '~'
+ *
+ * @param qual The quality line
+ *
+ * 16 charactors are checked at a time by clamping them into the range
+ * and comparing with themselves.
+ */
+inline bool valid_quals(const std::string& qual)
+{
+    using SIMD_Vector = simdpp::uint8<16>;
+    const SIMD_Vector lo = simdpp::make_uint('!')
+		    , hi = simdpp::make_uint('~')
+		    , ones = simdpp::make_uint(0xFF)
+		    , zeros = simdpp::make_uint(0);
+    size_t i(0);
+    for (; i + 16 <= qual.size(); i += 16)
+    {
+	SIMD_Vector q = simdpp::load_u(qual.data() + i);
+	SIMD_Vector in_range = simdpp::blend(ones, zeros,
+	    simdpp::cmp_eq(simdpp::min(simdpp::max(q, lo), hi), q));
+	if (simdpp::extract_bits<7>(in_range) != 0xFFFF)
+	    return false;
+    }
+    for (; i < qual.size(); i++)
+	if (qual[i] > '~' || qual[i] < '!')
+	    return false;
+    return true;
+}
+
+}
@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 #include <Biovoltron/base_vector.hpp>
+#include <Biovoltron/format/base_encoder.hpp>
 
 namespace biovoltron::format{
 
@@ -281,15 +282,16 @@ class FASTA_PE
      * warn user.<br>
      * Notice that, if there are n-bases in sequence. we store start 
      * point and length of every continueous n-base sub-sequence in 
-     * n_base_info_table, and use fast_rand to generate a basic base 
-     * used to replace a n-base. To do this, because we want to use
-     * 2 bits to compress the sequence, so we need to use a basic
-     * base to replace n-base.
+     * n_base_info_table, and use a generator seeded by the name of 
+     * the entry to generate a basic base used to replace a n-base, so 
+     * the same entry always gets the same bases. To do this, because 
+     * we want to use 2 bits to compress the sequence, so we need to 
+     * use a basic base to replace n-base.
      *
      * Time complexity: O(n)<br>
      *	    \e n: the length of sequence<br>
      *
-     * @sa FASTA_PE::fast_rand()
+     * @sa encode_seq()
      */
 	template <typename Iterator>
 	static FASTA_PE parse_obj(Iterator it)
@@ -314,65 +316,16 @@ class FASTA_PE
 
 					break;
 				case State::seq:
-					fa.seq.reserve(it->size());
-
-					for (size_t i(0); i < it->size(); i++)
-					{
-						switch (it->at(i))
-						{
-						case 'A':
-						case 'a':
-							fa.seq.push_back('A');
-							break;
-						case 'C':
-						case 'c':
-							fa.seq.push_back('C');
-							break;
-						case 'G':
-						case 'g':
-							fa.seq.push_back('G');
-							break;
-						case 'T':
-						case 't':
-							fa.seq.push_back('T');
-							break;
-						case 'N':
-						case 'n':
-							fa.n_base_info_table.emplace_back(i, 0);
-							for (; i < it->size() &&
-									(it->at(i) == 'N' ||
-									it->at(i) == 'n'); 
-								i++)
-							{
-							switch (fast_rand() % 4)
-							{
-								case 0:
-								fa.seq.push_back('A');
-								break;
-								case 1:
-								fa.seq.push_back('C');
-								break;
-								case 2:
-								fa.seq.push_back('G');
-								break;
-								case 3:
-								fa.seq.push_back('T');
-								break;
-							}
-							fa.n_base_info_table.back().second++;
-							}
-							i--;
-
-							break;
-						default:
-							throw fastaException(
-							"ERROR: get_obj(): invalid input "
-							"seq charactor\n"
-							);
-						}
-					}
+				{
+					NBaseRand rand(fa.name);
+					if (!encode_seq(*it, fa.seq, fa.n_base_info_table, rand))
+						throw fastaException(
+						"ERROR: get_obj(): invalid input "
+						"seq charactor\n"
+						);
 
 					break;
+				}
 			}
 		}
 
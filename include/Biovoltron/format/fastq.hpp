@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 #include <Biovoltron/base_vector.hpp>
+#include <Biovoltron/format/base_encoder.hpp>
 
 namespace biovoltron::format{
 
@@ -351,15 +352,16 @@ class FASTQ
      * warn user.<br>
      * Notice that, if there are n-bases in sequence. we store start 
      * point and length of every continueous n-base sub-sequence in 
-     * n_base_info_table, and use fast_rand to generate a basic base 
-     * used to replace a n-base. To do this, because we want to use
-     * 2 bits to compress the sequence, so we need to use a basic
-     * base to replace n-base.
+     * n_base_info_table, and use a generator seeded by the name of 
+     * the entry to generate a basic base used to replace a n-base, so 
+     * the same entry always gets the same bases. To do this, because 
+     * we want to use 2 bits to compress the sequence, so we need to 
+     * use a basic base to replace n-base.
      *
      * Time complexity: O(n)<br>
      *	    \e n: the length of sequence<br>
      *
-     * @sa FASTQ::fast_rand()
+     * @sa encode_seq()
      */
 	template <typename Iterator>
 	static FASTQ parse_obj(Iterator it)
@@ -384,65 +386,16 @@ class FASTQ
 
 					break;
 				case State::seq:
-					fq.seq.reserve(it->size());
-
-					for (size_t i(0); i < it->size(); i++)
-					{
-						switch (it->at(i))
-						{
-						case 'A':
-						case 'a':
-							fq.seq.push_back('A');
-							break;
-						case 'C':
-						case 'c':
-							fq.seq.push_back('C');
-							break;
-						case 'G':
-						case 'g':
-							fq.seq.push_back('G');
-							break;
-						case 'T':
-						case 't':
-							fq.seq.push_back('T');
-							break;
-						case 'N':
-						case 'n':
-							fq.n_base_info_table.emplace_back(i, 0);
-							for (; i < it->size() &&
-									(it->at(i) == 'N' ||
-									it->at(i) == 'n'); 
-								i++)
-							{
-							switch (fast_rand() % 4)
-							{
-								case 0:
-								fq.seq.push_back('A');
-								break;
-								case 1:
-								fq.seq.push_back('C');
-								break;
-								case 2:
-								fq.seq.push_back('G');
-								break;
-								case 3:
-								fq.seq.push_back('T');
-								break;
-							}
-							fq.n_base_info_table.back().second++;
-							}
-							i--;
-
-							break;
-						default:
-							throw FASTQException(
-							"ERROR: get_obj(): invalid input "
-							"seq charactor\n"
-							);
-						}
-					}
+				{
+					NBaseRand rand(fq.name);
+					if (!encode_seq(*it, fq.seq, fq.n_base_info_table, rand))
+						throw FASTQException(
+						"ERROR: get_obj(): invalid input "
+						"seq charactor\n"
+						);
 
 					break;
+				}
 				case State::plus:
 					if (it->size() == 0 || it->at(0) != '+')
 						throw FASTQException(
@@ -459,6 +412,18 @@ class FASTQ
 
 					break;
 				case State::qual:
+					if (it->size() != fq.seq.size())
+						throw FASTQException(
+						"ERROR: get_obj(): length of seq_qual field "
+						"is different to length of seq field\n"
+						);
+
+					if (!valid_quals(*it))
+						throw FASTQException(
+						"ERROR: get_obj(): wrong charactor in "
+						"quality string\n"
+						);
+
 					if constexpr (std::is_same_v<
 							QualType, 
 							biovoltron::vector<biovoltron::char_type>
@@ -469,22 +434,6 @@ class FASTQ
 					}
 					else
 						fq.seq_qual = std::move(*it);
-
-					if (fq.seq_qual.size() != fq.seq.size())
-						throw FASTQException(
-						"ERROR: get_obj(): length of seq_qual field "
-						"is different to length of seq field\n"
-						);
-
-
-					for (auto i : fq.seq_qual)
-						if (i > '~' || i < '!')
-						{
-							throw FASTQException(
-							"ERROR: get_obj(): wrong charactor in "
-							"quality string\n"
-							);
-						}
 			}
 		}
 
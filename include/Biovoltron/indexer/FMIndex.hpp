@@ -40,6 +40,35 @@ class FMIndex
   public:
   
   static constexpr auto lookup_len = LookupStrLen;
+
+	/***********************************************************
+	 * The last LookupStrLen bases of a query are looked up at 
+	 * once instead of walked base by base. Up to 
+	 * dense_lookup_max_len the lookup table is dense, it holds 
+	 * the first BWT row of every k-mer. Above that it is sparse:
+	 * lookup_kmers holds the k-mers present in the sequence with 
+	 * their first rows in k-mer order, and lookup_table holds 
+	 * where each bucket of k-mers sharing the first 
+	 * sparse_bucket_len bases starts in lookup_kmers.
+	 **********************************************************/
+	static constexpr uint32_t dense_lookup_max_len = 14;
+	static constexpr uint32_t sparse_bucket_len = 12;
+	static constexpr bool is_dense_lookup = 
+		LookupStrLen <= dense_lookup_max_len;
+
+	// the lookup field of the index header, sparse tables set the flag
+	static constexpr uint32_t sparse_lookup_flag = 1u << 31;
+	static constexpr uint32_t lookup_header = is_dense_lookup ? 
+		LookupStrLen : LookupStrLen | sparse_lookup_flag;
+
+	static_assert(LookupStrLen <= 32, 
+		"ERROR: lookup k-mers are coded in 64 bits");
+
+	/*
+	 * 2-bit sequences read a k-mer from one unaligned 64-bit load, 
+	 * shifted by up to 3 bases, which leaves 29 whole bases.
+	 */
+	static constexpr uint32_t packed_lookup_max_len = 29;
   
   using BaseType = typename SEQ::value_type;
 	using SizeType = typename SEQ::size_type;
@@ -76,6 +105,7 @@ class FMIndex
 	std::vector<IndexType> c_table, lookup_table;
 	std::vector<std::pair<IndexType, IndexType>> 
 		seg_info, n_table, loc_table, lookup_exception;
+	std::vector<std::pair<uint64_t, IndexType>> lookup_kmers;
     std::vector<std::vector<IndexType>> occ_table;
 	std::vector<bool> is_sampled_table;
 
@@ -88,7 +118,9 @@ class FMIndex
 		, order_to_char_(o_to_c)
 		, c_table(CharTypeNum, 0)
 		, occ_table(CharTypeNum)
-		, lookup_table(std::pow(CharTypeNum, LookupStrLen), (IndexType)-1)
+		, lookup_table(is_dense_lookup ? 
+			kmer_num(LookupStrLen) : kmer_num(sparse_bucket_len) + 1, 
+			(IndexType)-1)
 	{
 		if (PrefixLen != 0 && PrefixLen < LookupStrLen)
 			throw std::runtime_error(
@@ -114,9 +146,11 @@ class FMIndex
 		this->loc_table = std::move(fm.loc_table);
 		this->lookup_table = std::move(fm.lookup_table);
 		this->lookup_exception = std::move(fm.lookup_exception);
+		this->lookup_kmers = std::move(fm.lookup_kmers);
 		this->occ_table = std::move(fm.occ_table);
 		this->seg_info = std::move(fm.seg_info);
 		this->n_table = std::move(fm.n_table);
+		return *this;
 	}
 
 	template <
@@ -211,14 +245,28 @@ class FMIndex
 			*rit = *(rit + 1);
 		c_table.front() = 1;
 
-		if (lookup_table.back() == (IndexType)-1)
-			lookup_table.back() = bwt_seq.size();
-		for (auto rit(lookup_table.rbegin()); 
-			rit != lookup_table.rend() - 1; 
-			rit++)
+		if constexpr (is_dense_lookup)
 		{
-			if (*(rit + 1) == (IndexType)-1)
-				*(rit + 1) = *rit;
+			if (lookup_table.back() == (IndexType)-1)
+				lookup_table.back() = bwt_seq.size();
+			for (auto rit(lookup_table.rbegin()); 
+				rit != lookup_table.rend() - 1; 
+				rit++)
+			{
+				if (*(rit + 1) == (IndexType)-1)
+					*(rit + 1) = *rit;
+			}
+		}
+		else
+		{
+			// bucket sizes, then where each bucket starts
+			std::fill(lookup_table.begin(), lookup_table.end(), 0);
+			for (auto& kmer : lookup_kmers)
+				lookup_table[kmer_bucket(kmer.first) + 1]++;
+			for (auto it(lookup_table.begin()); 
+				it != lookup_table.end() - 1; 
+				it++)
+				*(it + 1) += *it;
 		}
 		dur2 += std::chrono::steady_clock::now() - clock2;
 		std::cout << "build: " << dur2.count() << " min\n";
@@ -460,7 +508,6 @@ class FMIndex
 			if (range.first >= range.second)
 			{
 				ret.first = std::distance(query.crbegin(), rit);
-				range_records.shrink_to_fit();
 				return ret;
 			}
 			range_records.emplace_back(range);
@@ -470,15 +517,113 @@ class FMIndex
 			range.first + max_candidate_num < range.second)
 		{
 			ret.first = -2;
-			range_records.shrink_to_fit();
 			return ret;
 		}
 		
 		ret.first = -1;
-		range_records.shrink_to_fit();
 		return ret;
 	}
 
+	/***********************************************************
+	 * Same as exact_match_by_base, but the last LookupStrLen 
+	 * bases of query are looked up at once when the lookup table
+	 * has them. range_records then holds the full range followed 
+	 * by the ranges from the LookupStrLen-th base on, and 
+	 * fill_lookup_records() puts back the ranges in between for 
+	 * callers walking every record.
+	 **********************************************************/
+  template <typename SeqType>
+	auto lookup_exact_match_by_base(
+		SeqType&& query, 
+		IndexType max_candidate_num, 
+		std::vector<std::pair<IndexType, IndexType>>& range_records) const
+	{
+		if (c_table.front() == 0)
+			throw std::runtime_error(
+				"ERROR: Should not do exact_match before building "
+				"fm-index\n"
+			);
+
+		if (PrefixLen - (1 << LogInterval) < query.size())
+			throw std::runtime_error(
+				"ERROR: Length of query too large for "
+				"PrefixLen of FMIndex"
+			);
+		
+		std::pair<IndexType, std::pair<IndexType, IndexType>> ret;
+		auto& range(ret.second);
+		auto rit(query.crbegin());
+    
+		range_records.reserve(query.size() + 1);
+    
+    range.first = 0;
+    range.second = bwt_seq.size();
+		range_records.emplace_back(range);
+
+		if (query.size() >= LookupStrLen)
+		{
+			std::pair<IndexType, IndexType> kmer_range;
+			lookup(query, kmer_range);
+			if (kmer_range.first < kmer_range.second)
+			{
+				range = kmer_range;
+				range_records.emplace_back(range);
+				rit += LookupStrLen;
+			}
+		}
+
+		for (auto rend(query.crend()); rit != rend; rit++)
+		{
+			range.first = lf_mapping(range.first, *rit);
+			range.second = lf_mapping(range.second, *rit);
+			if (range.first >= range.second)
+			{
+				ret.first = std::distance(query.crbegin(), rit);
+				return ret;
+			}
+			range_records.emplace_back(range);
+		}
+
+		if (max_candidate_num != 0 && 
+			range.first + max_candidate_num < range.second)
+		{
+			ret.first = -2;
+			return ret;
+		}
+		
+		ret.first = -1;
+		return ret;
+	}
+
+	/***********************************************************
+	 * Puts back the ranges lookup_exact_match_by_base skipped, 
+	 * match_len is the number of bases the search matched. 
+	 * range_records is left as is if nothing was skipped.
+	 **********************************************************/
+  template <typename SeqType>
+	void fill_lookup_records(
+		SeqType&& query, 
+		IndexType match_len, 
+		std::vector<std::pair<IndexType, IndexType>>& range_records) const
+	{
+		if (range_records.size() > match_len)
+			return;
+
+		std::array<std::pair<IndexType, IndexType>, LookupStrLen - 1> 
+			skipped;
+		auto range(range_records.front());
+		auto rit(query.crbegin());
+		for (auto& r : skipped)
+		{
+			range.first = lf_mapping(range.first, *rit);
+			range.second = lf_mapping(range.second, *rit);
+			r = range;
+			rit++;
+		}
+		range_records.insert(range_records.begin() + 1, 
+			skipped.cbegin(), skipped.cend());
+	}
+
 	template <typename SeqType>
 	auto sbwt_exact_match(
 		SeqType&& query, 
@@ -523,6 +668,22 @@ class FMIndex
 		SeqType&& query, 
 		IndexType max_candidate_num, 
 		std::vector<std::pair<IndexType, IndexType>>& range_records) const
+	{
+		SEQ sbwt_query;
+		
+		return sbwt_exact_match_by_base(query, max_candidate_num, 
+				range_records, sbwt_query
+			);
+	}
+
+	// same as above, the reverse complement query is built in sbwt_query,
+	// so callers can reuse its buffer and the query afterwards
+  template <typename SeqType>
+	auto sbwt_exact_match_by_base(
+		SeqType&& query, 
+		IndexType max_candidate_num, 
+		std::vector<std::pair<IndexType, IndexType>>& range_records,
+		SEQ& sbwt_query) const
 	{
 		if (c_table.front() == 0)
 			throw std::runtime_error(
@@ -530,8 +691,7 @@ class FMIndex
 				"before building fm-index\n"
 			);
 		
-		SEQ sbwt_query;
-		
+		sbwt_query.clear();
 		make_rc_query(sbwt_query, query);
 		
 		return exact_match_by_base(sbwt_query, max_candidate_num, 
@@ -539,6 +699,28 @@ class FMIndex
 			);
 	}
 
+	// lookup_exact_match_by_base on the reverse complement query
+  template <typename SeqType>
+	auto sbwt_lookup_exact_match_by_base(
+		SeqType&& query, 
+		IndexType max_candidate_num, 
+		std::vector<std::pair<IndexType, IndexType>>& range_records,
+		SEQ& sbwt_query) const
+	{
+		if (c_table.front() == 0)
+			throw std::runtime_error(
+				"ERROR: Should not do sbwt_exact_match "
+				"before building fm-index\n"
+			);
+		
+		sbwt_query.clear();
+		make_rc_query(sbwt_query, query);
+		
+		return lookup_exact_match_by_base(sbwt_query, max_candidate_num, 
+				range_records
+			);
+	}
+
 	inline IndexType lf_mapping(
 		IndexType idx, 
 		typename SEQ::value_type ch) const
@@ -549,6 +731,18 @@ class FMIndex
 			);
 	}
 
+	// lf_mapping of every charactor, in the order of order_to_char
+	inline std::array<IndexType, CharTypeNum> lf_mapping_all(
+		IndexType idx) const
+	{
+		auto occ(occ_tracking_all(idx, 
+				idx >> LogInterval << LogInterval
+			));
+		for (IndexType i(0); i < CharTypeNum; i++)
+			occ[i] += c_table[i];
+		return occ;
+	}
+
 	inline IndexType bwt_idx_to_seq_idx(IndexType idx)
 	{
 		IndexType count(0);
@@ -573,16 +767,25 @@ class FMIndex
 	{
 		std::vector<IndexType> results;
 		
+		sbwt_range_to_seq_idx(range, query_len, results);
+		return results;
+	}
+
+	// appends the positions to results, whose buffer can be reused
+	void sbwt_range_to_seq_idx(
+		const std::pair<IndexType, IndexType>& range, 
+		const IndexType& query_len,
+		std::vector<IndexType>& results) const
+	{
 		if (range.first >= range.second)
-			return results;
+			return;
 
-		results.reserve(range.second - range.first);
+		results.reserve(results.size() + range.second - range.first);
 		//results.resize(range.second - range.first);
 		IndexType candidate_num = range.second - range.first;
     sbwt_range_to_seq_idx_impl(
 			results, candidate_num, range, 0, query_len
 		);
-		return results;
 	}
 
 	void save(
@@ -601,11 +804,13 @@ class FMIndex
 				);
 			
 			boost::archive::binary_oarchive arch(ofs_b);
-			arch << LogInterval << CharTypeNum << LookupStrLen << 
+			arch << LogInterval << CharTypeNum << lookup_header << 
 				PrefixLen << char_to_order_ << order_to_char_ << 
 				bwt_seq << seq_end_pos << c_table << loc_table << 
 				lookup_table << lookup_exception << occ_table << 
 				seg_info << n_table << chr_names;
+			if constexpr (!is_dense_lookup)
+				arch << lookup_kmers;
 		}
 		else
 		{
@@ -617,11 +822,13 @@ class FMIndex
 				);
 
 			boost::archive::text_oarchive arch(ofs_t);
-			arch << LogInterval << CharTypeNum << LookupStrLen << 
+			arch << LogInterval << CharTypeNum << lookup_header << 
 				PrefixLen << char_to_order_ << order_to_char_ << 
 				bwt_seq << seq_end_pos << c_table << loc_table << 
 				lookup_table << lookup_exception << occ_table << 
 				seg_info << n_table << chr_names;
+			if constexpr (!is_dense_lookup)
+				arch << lookup_kmers;
 		}
 	}
 
@@ -648,7 +855,7 @@ class FMIndex
 
 			if (log_interval != LogInterval || 
 				char_type_num != CharTypeNum || 
-				lookup_str_len != LookupStrLen || 
+				lookup_str_len != lookup_header || 
 				prefix_len != PrefixLen)
 			{
 				throw std::runtime_error(
@@ -661,6 +868,8 @@ class FMIndex
 				seq_end_pos >> c_table >> loc_table >> 
 				lookup_table >> lookup_exception >> occ_table >> 
 				seg_info >> n_table >> chr_names;
+			if constexpr (!is_dense_lookup)
+				arch >> lookup_kmers;
 		}
 		else
 		{
@@ -677,7 +886,7 @@ class FMIndex
 
 			if (log_interval != LogInterval || 
 				char_type_num != CharTypeNum || 
-				lookup_str_len != LookupStrLen || 
+				lookup_str_len != lookup_header || 
 				prefix_len != PrefixLen)
 			{
 				throw std::runtime_error(
@@ -690,6 +899,8 @@ class FMIndex
 				seq_end_pos >> c_table >> loc_table >> 
 				lookup_table >> lookup_exception >> occ_table >> 
 				seg_info >> n_table >> chr_names;
+			if constexpr (!is_dense_lookup)
+				arch >> lookup_kmers;
 		}
 	}
 
@@ -780,7 +991,7 @@ class FMIndex
 		const SuffixArrayType& group, 
 		IndexType& cumulative_idx)
 	{
-		IndexType lookup_count(0);
+		uint64_t lookup_count(0);
 		  /*constexpr size_t mask(0b11), 
 			  bases_per_byte(SEQ::bases_per_word / sizeof(size_t)), 
 			  log_bases_per_byte(std::log2(bases_per_byte)), 
@@ -816,6 +1027,8 @@ class FMIndex
 						biovoltron::vector<typename SEQ::value_type>
 					>)
 				{
+					static_assert(LookupStrLen <= packed_lookup_max_len, 
+						"ERROR: 2-bit lookup k-mers are read from one 64-bit word");
 		      constexpr size_t mask(0b11), 
 			      bases_per_byte(SEQ::bases_per_word / sizeof(size_t)), 
 			      log_bases_per_byte(std::log2(bases_per_byte)), 
@@ -844,22 +1057,39 @@ class FMIndex
 						j < end; 
 						j++)
 					{
-						lookup_count += char_to_order_[seq[j]] *
-							std::pow(CharTypeNum, end - j - 1);
+						lookup_count = lookup_count * CharTypeNum + 
+							char_to_order_[seq[j]];
 					}
 				}
 				
 
-				if (lookup_table[lookup_count] == (IndexType)-1)
-					lookup_table[lookup_count] = cumulative_idx;
+				if constexpr (is_dense_lookup)
+				{
+					if (lookup_table[lookup_count] == (IndexType)-1)
+						lookup_table[lookup_count] = cumulative_idx;
+				}
+				else
+				{
+					if (lookup_kmers.empty() || 
+						lookup_kmers.back().first != lookup_count)
+						lookup_kmers.emplace_back(
+							lookup_count, cumulative_idx
+						);
+				}
 			}
 			else
 			{
-				if (lookup_exception.size() == 0 || 
-					lookup_exception.back().first != lookup_count)
+				// the sparse table keys the exceptions by the index 
+				// of the k-mer in lookup_kmers
+				IndexType key(lookup_count);
+				if constexpr (!is_dense_lookup)
+					key = lookup_kmers.size() - 1;
+				if ((is_dense_lookup || !lookup_kmers.empty()) && 
+					(lookup_exception.size() == 0 || 
+					lookup_exception.back().first != key))
 				{
 					lookup_exception.emplace_back(
-						lookup_count, cumulative_idx
+						key, cumulative_idx
 					);
 				}
 			}
@@ -915,6 +1145,40 @@ class FMIndex
 		return occ;
 	}
 
+	// occ_tracking of every charactor with one scan of bwt_seq
+	std::array<IndexType, CharTypeNum> occ_tracking_all(
+		IndexType idx, 
+		IndexType checkpoint) const
+	{
+		std::array<IndexType, CharTypeNum> occ;
+
+		if (checkpoint == bwt_seq.size())
+			checkpoint -= interval;
+
+		if ((idx & interval - 1) >> (LogInterval - 1) == 0 || 
+			checkpoint + interval >= bwt_seq.size())
+		{
+			for (IndexType i(0); i < CharTypeNum; i++)
+				occ[i] = occ_table[i][checkpoint >> LogInterval];
+			for (IndexType i(checkpoint); i < idx; i++)
+				occ[char_to_order_[bwt_seq[i]]]++;
+			if (checkpoint <= seq_end_pos && idx > seq_end_pos)
+				occ.front()--;
+		}
+		else
+		{
+			checkpoint += interval;
+			for (IndexType i(0); i < CharTypeNum; i++)
+				occ[i] = occ_table[i][checkpoint >> LogInterval];
+			for (IndexType i(checkpoint - 1); i >= idx; i--)
+				occ[char_to_order_[bwt_seq[i]]]--;
+			if (checkpoint > seq_end_pos && idx <= seq_end_pos)
+				occ.front()++;
+		}
+
+		return occ;
+	}
+
 	template <typename SeqType>
 	void lookup(
 		SeqType&& query, 
@@ -928,6 +1192,8 @@ class FMIndex
 				biovoltron::vector<typename SEQ::value_type>
 			>)
 		{
+			static_assert(LookupStrLen <= packed_lookup_max_len, 
+				"ERROR: 2-bit lookup k-mers are read from one 64-bit word");
 			constexpr size_t mask(0b11), 
 				bases_per_byte(SEQ::bases_per_word / sizeof(size_t)), 
 				log_bases_per_byte(std::log2(bases_per_byte)), 
@@ -958,29 +1224,75 @@ class FMIndex
 				i < query.size(); 
 				i++)
 			{
-				lookup_count += char_to_order_[query[i]] *
-					std::pow(CharTypeNum, query.size() - i - 1);
+				lookup_count = lookup_count * CharTypeNum + 
+					char_to_order_[query[i]];
 			}
 		}
+
+		// key of the exceptions, and the row after the last k-mer
+		uint64_t key(lookup_count);
+		IndexType next_row;
+		if constexpr (is_dense_lookup)
+		{
+			range.first = lookup_table[lookup_count];
+			next_row = lookup_count + 1 < lookup_table.size() ? 
+				lookup_table[lookup_count + 1] : bwt_seq.size();
+		}
+		else
+		{
+			auto bucket(kmer_bucket(lookup_count));
+			auto first(lookup_kmers.cbegin() + lookup_table[bucket]), 
+				last(lookup_kmers.cbegin() + lookup_table[bucket + 1]);
+			auto kmer = std::lower_bound(first, last, lookup_count, 
+				[](const std::pair<uint64_t, IndexType>& a, uint64_t b)
+				{
+					return a.first < b;
+				}
+			);
+
+			if (kmer == last || kmer->first != lookup_count)
+			{
+				range.first = range.second = 0;
+				return;
+			}
+			range.first = kmer->second;
+			key = std::distance(lookup_kmers.cbegin(), kmer);
+			next_row = kmer + 1 != lookup_kmers.cend() ? 
+				(kmer + 1)->second : bwt_seq.size();
+		}
 		
 		auto it = std::lower_bound(
 			lookup_exception.cbegin(), 
 			lookup_exception.cend(), 
-			lookup_count, 
+			key, 
 			[](const std::pair<IndexType, IndexType>& a, 
-				IndexType b)
+				uint64_t b)
 			{
 				return a.first < b;
 			}
 		);
 
-		range.first = lookup_table[lookup_count];
 		if (it != lookup_exception.cend() && 
-			it->first == lookup_count
+			it->first == key
 		)
 			range.second = it->second;
 		else
-			range.second = lookup_table[lookup_count + 1];
+			range.second = next_row;
+	}
+
+	// number of k-mers of length len
+	static constexpr uint64_t kmer_num(uint32_t len)
+	{
+		uint64_t num(1);
+		for (uint32_t i(0); i < len; i++)
+			num *= CharTypeNum;
+		return num;
+	}
+
+	// bucket of a k-mer in the sparse lookup table, its first bases
+	static constexpr uint64_t kmer_bucket(uint64_t kmer)
+	{
+		return kmer / kmer_num(LookupStrLen - sparse_bucket_len);
 	}
 
 	void sbwt_range_to_seq_idx_impl(
@@ -35,15 +35,22 @@ void PE_trim()
                             , trimmer_param\
                             , loc_tail\
                             , default_adapter\
-                            , DETECT_N_READS\
-                            , is_sensitive)
+                            , detect_max_reads\
+                            , detect_max_seconds\
+                            , is_sensitive\
+                            , is_interleaved_input\
+                            , is_interleaved_output)
+
+    // stdin/stdout are only reachable through boost iostreams
+    bool is_stream_input = is_gz_input || is_std_stream(ifs_name[0]);
+    bool is_stream_output = is_gz_output || is_stdout_output;
 
     if (is_fastq)
     {
         record_line = 4;
-        if (is_gz_input)
+        if (is_stream_input)
         {
-            if (is_gz_output)
+            if (is_stream_output)
             {
                 TaskProcessor<
                     FASTQ, BitStr, 
@@ -62,7 +69,7 @@ void PE_trim()
         }
         else
         {
-            if (is_gz_output)
+            if (is_stream_output)
             {
                 TaskProcessor<
                     FASTQ, BitStr, 
@@ -83,9 +90,9 @@ void PE_trim()
     else
     {
         record_line = 2;
-        if (is_gz_input)
+        if (is_stream_input)
         {
-            if (is_gz_output)
+            if (is_stream_output)
             {
                 TaskProcessor<
                     FASTA_PE, BitStr, 
@@ -104,7 +111,7 @@ void PE_trim()
         }
         else
         {
-            if (is_gz_output)
+            if (is_stream_output)
             {
                 TaskProcessor<
                     FASTA_PE, BitStr, 
@@ -6,12 +6,15 @@
 #include <EARRINGS/PE/buffer_manager.hpp>
 #include <EARRINGS/PE/rw_count.hpp>
 #include <EARRINGS/PE/trimmer.hpp>
+#include <EARRINGS/detect_convergence.hpp>
 #include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <tuple>
 #include <string_view>
 #include <algorithm>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 using namespace EARRINGS;
@@ -36,13 +39,26 @@ private:
     std::vector<OFS> _ofs;
     std::vector<std::string> _default_adapters;
     std::vector<BITSTR> _adapters;
+    // reads sampled for adapter detection, replayed before the rest of the 
+    // input so that the input is never reopened (required by stdin).
+    std::vector<std::vector<std::string>> _sample;
+    size_t _sample_idx;
+    size_t _sample_lines;
     size_t _detect_n_reads;
+    float _detect_max_seconds;
     size_t _thread_num;
     size_t _record_line;
     size_t _chunk_size;
     bool _loc_tail;
     bool _is_sensitive;
-
+    bool _interleaved_in;
+    bool _interleaved_out;
+
+    void open_input(size_t, const std::string&);
+    void open_output(size_t, const std::string&);
+    bool get_interleaved_pair(std::vector<std::string>&
+                            , std::vector<std::string>&
+                            , size_t);
     void preprocess(FORMAT2BIT&, FORMAT2BIT&, size_t);
     void detect_adapters();
     void trim_reads(Task&);
@@ -65,6 +81,9 @@ public:
                 , bool
                 , std::vector<std::string>&
                 , size_t
+                , float
+                , bool
+                , bool
                 , bool);
     void process();
 };
@@ -79,55 +98,34 @@ TaskProcessor<FORMAT, BITSTR, IFS, OFS>::TaskProcessor(size_t thread_num
                                                     , bool loc_tail
                                                     , std::vector<std::string>& default_adapter
                                                     , size_t detect_n_reads
-                                                    , bool is_sensitive)
+                                                    , float detect_max_seconds
+                                                    , bool is_sensitive
+                                                    , bool interleaved_in
+                                                    , bool interleaved_out)
     // input/output files
     : _ifs(2)
     , _ofs(2)
+    , _sample_idx(0)
+    , _sample_lines(0)
+    , _interleaved_in(interleaved_in)
+    , _interleaved_out(interleaved_out)
     , _record_line(record_line)
     , _chunk_size(chunk_size)
     , _thread_num(thread_num)
     , _detect_n_reads(detect_n_reads)
+    , _detect_max_seconds(detect_max_seconds)
     , _default_adapters(default_adapter)
 {
     _buf_manager.set_chunk_size(chunk_size, _thread_num);
         
+    // interleaved input/output carries both mates in the first stream
     for (size_t i = 0; i < 2; ++i)
     {
-        if constexpr (std::is_same_v<remove_cvr_t<IFS>, BIO_filtering_istream>)
-        {
-            _ifs[i].push(boost::iostreams::gzip_decompressor());
-            auto&& src(boost::iostreams::file_source(ifs_name[i], std::ios_base::binary));
-            if (!src.is_open())
-                throw std::runtime_error("Can't open input gz file normally\n");
-            
-            _ifs[i].push(src);
-            if (!_ifs[i].good())
-                throw std::runtime_error("Can't open input gz stream normally\n");
-        }
-        else
-        {
-            _ifs[i].open(ifs_name[i]);
-            if (!(_ifs[i].is_open() && _ifs[i].good()))
-                throw std::runtime_error("Can't open input file normally\n");
-        }
-
-        if constexpr (std::is_same_v<remove_cvr_t<OFS>, BIO_filtering_ostream>)
-        {
-            _ofs[i].push(boost::iostreams::gzip_compressor());
-            auto&& sink(boost::iostreams::file_sink(ofs_name[i], std::ios_base::binary));
-            if (!sink.is_open())
-                throw std::runtime_error("Can't open output gz file normally\n");
+        if (i == 0 || !_interleaved_in)
+            open_input(i, ifs_name[i]);
 
-            _ofs[i].push(sink);
-            if (!_ifs[i].good())
-                throw std::runtime_error("Can't open input gz stream normally\n");
-        }
-        else
-        {
-            _ofs[i].open(ofs_name[i]);
-            if (!(_ofs[i].is_open() && _ofs[i].good()))
-                throw std::runtime_error("Can't open output file normally\n");
-        }
+        if (i == 0 || !_interleaved_out)
+            open_output(i, ofs_name[i]);
     }
 
     // create tmp dir
@@ -152,6 +150,94 @@ TaskProcessor<FORMAT, BITSTR, IFS, OFS>::TaskProcessor(size_t thread_num
     _is_sensitive = is_sensitive;
 }
 
+template<template<class> class FORMAT, class BITSTR, typename IFS, typename OFS>
+void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::open_input(size_t i, const std::string& fname)
+{
+    if constexpr (std::is_same_v<remove_cvr_t<IFS>, BIO_filtering_istream>)
+    {
+        if (is_gz_input)
+            _ifs[i].push(boost::iostreams::gzip_decompressor());
+
+        if (is_std_stream(fname))
+        {
+            _ifs[i].push(std::cin);
+        }
+        else
+        {
+            auto&& src(boost::iostreams::file_source(fname, std::ios_base::binary));
+            if (!src.is_open())
+                throw std::runtime_error("Can't open input gz file normally\n");
+            
+            _ifs[i].push(src);
+        }
+        if (!_ifs[i].good())
+            throw std::runtime_error("Can't open input gz stream normally\n");
+    }
+    else
+    {
+        _ifs[i].open(fname);
+        if (!(_ifs[i].is_open() && _ifs[i].good()))
+            throw std::runtime_error("Can't open input file normally\n");
+    }
+}
+
+template<template<class> class FORMAT, class BITSTR, typename IFS, typename OFS>
+void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::open_output(size_t i, const std::string& fname)
+{
+    if constexpr (std::is_same_v<remove_cvr_t<OFS>, BIO_filtering_ostream>)
+    {
+        if (is_gz_output)
+            _ofs[i].push(boost::iostreams::gzip_compressor());
+
+        if (is_std_stream(fname))
+        {
+            // std::cout is redirected to stderr for messages, write to fd directly
+            _ofs[i].push(boost::iostreams::file_descriptor_sink(
+                STDOUT_FILENO, boost::iostreams::never_close_handle));
+        }
+        else
+        {
+            auto&& sink(boost::iostreams::file_sink(fname, std::ios_base::binary));
+            if (!sink.is_open())
+                throw std::runtime_error("Can't open output gz file normally\n");
+
+            _ofs[i].push(sink);
+        }
+        if (!_ofs[i].good())
+            throw std::runtime_error("Can't open output gz stream normally\n");
+    }
+    else
+    {
+        _ofs[i].open(fname);
+        if (!(_ofs[i].is_open() && _ofs[i].good()))
+            throw std::runtime_error("Can't open output file normally\n");
+    }
+}
+
+template<template<class> class FORMAT, class BITSTR, typename IFS, typename OFS>
+bool TaskProcessor<FORMAT, BITSTR, IFS, OFS>::get_interleaved_pair(
+                                                      std::vector<std::string>& buf1
+                                                    , std::vector<std::string>& buf2
+                                                    , size_t pos)
+{
+    for (size_t j(0); j < _record_line; ++j)
+        std::getline(_ifs[0], buf1[pos + j]);
+
+    for (size_t j(0); j < _record_line; ++j)
+        std::getline(_ifs[0], buf2[pos + j]);
+
+    if (_ifs[0].fail())
+    {
+        // getline clears the line before extracting, so an unpaired mate 1 
+        // leaves a non-empty name line.
+        if (buf1[pos].length() != 0)
+            throw std::runtime_error("Interleaved input has an unpaired record.\n");
+        return false;
+    }
+
+    return true;
+}
+
 template<template<class> class FORMAT, class BITSTR, typename IFS, typename OFS>
 void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::process()
 {
@@ -199,65 +285,73 @@ void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::preprocess(FORMAT2BIT& fm1
 template<template<class> class FORMAT, class BITSTR, typename IFS, typename OFS>
 void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::detect_adapters()
 {
-    // detect adapter using the first N reads
-    size_t total_lines = record_line * _detect_n_reads;
-    std::vector<std::vector<std::string>> reads(2, std::vector<std::string>(total_lines));
+    // detect adapter using the first pairs, batch by batch until the
+    // fragments converge or the budget is used up
+    _sample = decltype(_sample)(2);
+    auto& reads = _sample;
 
-    size_t i(0);
-    for (; i < total_lines && _ifs[0].good() && _ifs[1].good(); ++i)
-    {
-        std::getline(_ifs[0], reads[0][i]);
-        std::getline(_ifs[1], reads[1][i]);
-    }
-    // cutoff lines
-    i = (i / record_line) * record_line;
+    // parse_obj moves the lines out, keep the sample intact for trimming
+    std::vector<std::vector<std::string>> record(2, std::vector<std::string>(record_line));
+    FORMAT2BIT fm1, fm2;
+    // possible adapter fragments
+    std::vector<std::vector<std::string>> adapter_frags(2);
+    DetectConvergence<2> convergence(_detect_n_reads, _detect_max_seconds);
 
-    // reset ifstreams
-    for (size_t j(0); j < 2; ++j)
+    size_t i(0);
+    bool eof(false);
+    while (!eof)
     {
-        if constexpr (std::is_same_v<remove_cvr_t<IFS>, BIO_filtering_istream>)
+        size_t begin(i), total_lines(i + record_line * DETECT_BATCH_READS);
+        reads[0].resize(total_lines);
+        reads[1].resize(total_lines);
+        if (_interleaved_in)
         {
-            _ifs[j].pop();
-            auto&& src(boost::iostreams::file_source(ifs_name[j], std::ios_base::binary));
-            if (!src.is_open())
-                throw std::runtime_error("Can't reopen input gz file normally\n");
-            
-            _ifs[j].push(src);
-            if (!_ifs[j].good())
-                throw std::runtime_error("Can't reopen input gz stream normally\n");
+            for (; i < total_lines && _ifs[0].good(); i += record_line)
+            {
+                if (!get_interleaved_pair(reads[0], reads[1], i))
+                    break;
+            }
         }
         else
         {
-            _ifs[j].close();
-            _ifs[j].open(ifs_name[j]);
-            if (!(_ifs[j].is_open() && _ifs[j].good()))
-                throw std::runtime_error("Can't reopen input file normally\n");
+            for (; i < total_lines && _ifs[0].good() && _ifs[1].good(); ++i)
+            {
+                std::getline(_ifs[0], reads[0][i]);
+                std::getline(_ifs[1], reads[1][i]);
+            }
+            // cutoff lines
+            i = (i / record_line) * record_line;
         }
-    }
-
-    FORMAT2BIT fm1, fm2;
-    // possible adapter fragments
-    std::vector<std::vector<std::string>> adapter_frags(2);
-    adapter_frags[0].reserve(i);
-    adapter_frags[1].reserve(i);
+        eof = i < total_lines;
 
-    for (size_t j(0); j < i - 1; j += record_line) 
-	{
-        fm1 = FORMAT2BIT::parse_obj(
-            reads[0].begin() + j);
-        fm2 = FORMAT2BIT::parse_obj(
-            reads[1].begin() + j);
-
-        preprocess(fm1, fm2, j);
-
-        _tr.cut_off_longer_seq(fm1, fm2);
-        auto trim_pos = _tr.find_rc_pos(fm1, fm2, _adapters);
-        if (trim_pos == fm1.seq.size())
-            continue;
+        for (size_t j(begin); j + 1 < i; j += record_line) 
+        {
+            std::copy_n(reads[0].begin() + j, record_line, record[0].begin());
+            std::copy_n(reads[1].begin() + j, record_line, record[1].begin());
+            fm1 = FORMAT2BIT::parse_obj(record[0].begin());
+            fm2 = FORMAT2BIT::parse_obj(record[1].begin());
+
+            preprocess(fm1, fm2, j);
+
+            _tr.cut_off_longer_seq(fm1, fm2);
+            auto trim_pos = _tr.find_rc_pos(fm1, fm2, _adapters);
+            if (trim_pos == fm1.seq.size())
+                continue;
+
+            adapter_frags[0].emplace_back(reads[0][j + 1].substr(trim_pos));
+            adapter_frags[1].emplace_back(reads[1][j + 1].substr(trim_pos));
+            convergence.add_tail(adapter_frags[0].back(), 0);
+            convergence.add_tail(adapter_frags[1].back(), 1);
+        }
 
-        adapter_frags[0].emplace_back(reads[0][j + 1].substr(trim_pos));
-        adapter_frags[1].emplace_back(reads[1][j + 1].substr(trim_pos));
-	}
+        if (convergence.update((i - begin) / record_line))
+            break;
+    }
+    reads[0].resize(i);
+    reads[1].resize(i);
+    _sample_lines = i;
+    _sample_idx = 0;
+    convergence.report(std::cout);
     std::string tmp1, tmp2;
     bool is_low_complexity = false;
     if (_is_sensitive)
@@ -382,6 +476,8 @@ void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::write_task(Task& task)
 	tmp1.reserve(_buf_manager.buf[0][start_pos + 1].length() * 3 * _chunk_size);
 	tmp2.reserve(_buf_manager.buf[0][start_pos + 1].length() * 3 * _chunk_size);
 
+    // interleaved output puts mate 2 right after mate 1 in the first file
+    auto& out2 = _interleaved_out ? tmp1 : tmp2;
 	for(size_t i(start_pos); i < end_pos; i += _record_line)
     {
          if (_buf_manager.buf[0][i].length() == 0) continue;
@@ -389,9 +485,11 @@ void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::write_task(Task& task)
          {
              tmp1.append(_buf_manager.buf[0][i + j]);
              tmp1.append("\n");
-
-             tmp2.append(_buf_manager.buf[1][i + j]);
-             tmp2.append("\n");
+         }
+         for (size_t j(0); j < _record_line; ++j)
+         {
+             out2.append(_buf_manager.buf[1][i + j]);
+             out2.append("\n");
          }
     }
 
@@ -428,7 +526,9 @@ void TaskProcessor<FORMAT, BITSTR, IFS, OFS>::write_all_task()
             if(!tmp.good())
                 throw std::runtime_error("Can't read from specified files\n");
     
-            _ofs[j] << tmp.rdbuf();
+            // empty tmp files of mate 2 under interleaved output
+            if (j == 0 || !_interleaved_out)
+                _ofs[j] << tmp.rdbuf();
             std::filesystem::remove(tmp_fname);
         }
         std::filesystem::remove_all(path);   
@@ -505,14 +605,40 @@ bool TaskProcessor<FORMAT, BITSTR, IFS, OFS>::read_reads(Task& task)
 	size_t start_pos = task.buf_idx * _chunk_size;
 	size_t i(start_pos);
 
-	for (; i < start_pos + _chunk_size && _ifs[0].good() && _ifs[1].good(); ++i)
-	{
-		std::getline(_ifs[0], _buf_manager.buf[0][i]);
-		std::getline(_ifs[1], _buf_manager.buf[1][i]);
-	}
+    // replay the reads sampled by detect_adapters first
+    for (; i < start_pos + _chunk_size && _sample_idx < _sample_lines; ++i, ++_sample_idx)
+    {
+        _buf_manager.buf[0][i].swap(_sample[0][_sample_idx]);
+        _buf_manager.buf[1][i].swap(_sample[1][_sample_idx]);
+    }
+    if (_sample_idx == _sample_lines)
+    {
+        _sample = decltype(_sample)();
+    }
 
-	bool eof1 = !_ifs[0].good();
-	bool eof2 = !_ifs[1].good();
+    bool eof1(false), eof2(false);
+    if (_interleaved_in)
+    {
+        for (; i < start_pos + _chunk_size && _ifs[0].good(); i += _record_line)
+        {
+            if (!get_interleaved_pair(_buf_manager.buf[0], _buf_manager.buf[1], i))
+                break;
+        }
+        eof1 = eof2 = !_ifs[0].good();
+    }
+    else
+    {
+        for (; i < start_pos + _chunk_size && _ifs[0].good() && _ifs[1].good(); ++i)
+        {
+            std::getline(_ifs[0], _buf_manager.buf[0][i]);
+            std::getline(_ifs[1], _buf_manager.buf[1][i]);
+        }
+        eof1 = !_ifs[0].good();
+        eof2 = !_ifs[1].good();
+    }
+    // the sample may still fill up the next chunks
+    eof1 = eof1 && _sample_idx == _sample_lines;
+    eof2 = eof2 && _sample_idx == _sample_lines;
 	
 	if (eof1 != eof2)
 	{
@@ -3,9 +3,9 @@
 #define FLANKING_BASE 16
 
 #define FLANKING_BYTE (FLANKING_BASE / 4)
-#define MAX_BASE 256
 #define ALIGN_BYTE (ALIGN_BASE / 4)
 #define ALIGN_BASE 64
+#define WORD_BASE 32
 
 #include <array>
 #include <cmath>
@@ -86,14 +86,20 @@ class Trimmer <PAIRED, FORMAT>
     template<bool Check_Adapter=false, class SEQ>
     size_t find_rc_pos(FORMAT& fq1, FORMAT& fq2, std::vector<SEQ>& adapters) const
     {
-        std::vector<size_t> possible_pos1, possible_pos2, 
-            intersect_pos;
+        auto& buf = scratch();
+        auto& possible_pos1 = buf.possible_pos1;
+        auto& possible_pos2 = buf.possible_pos2;
+        auto& intersect_pos = buf.intersect_pos;
+        possible_pos1.clear();
+        possible_pos2.clear();
+        intersect_pos.clear();
 
-        auto rc1 = get_rc(fq1.seq, FLANKING_BASE);
-        auto rc2 = get_rc(fq2.seq, FLANKING_BASE);
+        alignas(ALIGN_BYTE) uint64_t rc1[ALIGN_BYTE / 8] = {}, rc2[ALIGN_BYTE / 8] = {};
+        get_rc(rc1, fq1.seq, std::min(fq1.seq.size(), (size_t)FLANKING_BASE));
+        get_rc(rc2, fq2.seq, std::min(fq2.seq.size(), (size_t)FLANKING_BASE));
         
-        find_possible_pos(possible_pos1, fq1.seq, rc2);
-        find_possible_pos(possible_pos2, fq2.seq, rc1);
+        find_possible_pos(possible_pos1, fq1.seq, simdpp::load(rc2));
+        find_possible_pos(possible_pos2, fq2.seq, simdpp::load(rc1));
     
         for (auto it1(possible_pos1.begin()), 
             it2(possible_pos2.begin());
@@ -117,15 +123,22 @@ class Trimmer <PAIRED, FORMAT>
 
         // std::cerr << "intersec_pos: " << intersect_pos.size() << "\n";
         size_t min_len1(0), min_len2(0);
-        SEQ subseq1, subseq2, r_seq;
         for (auto r_it(intersect_pos.rbegin()); 
             r_it != intersect_pos.rend(); 
             r_it++)
         {
             idx = *r_it;
 
-            r_seq = get_rc(fq2.seq, idx);
-            if ((float)cal_match_num(fq1.seq, r_seq, idx) / idx
+            // one more zero word, so the last block can be loaded whole
+            buf.r_seq.resize(idx / WORD_BASE + 2);
+            buf.r_seq[idx / WORD_BASE] = buf.r_seq[idx / WORD_BASE + 1] = 0;
+            get_rc(buf.r_seq.data(), fq2.seq, idx);
+            auto r_seq(buf.r_seq.data());
+            if ((float)cal_match_num(
+                    [&fq1](size_t i){ return load_window(fq1.seq, i); },
+                    [r_seq](size_t i) -> SIMD_Vector
+                    { return simdpp::load_u(r_seq + i / WORD_BASE); },
+                    idx) / idx
                     >= trait_parm.seq_cmp_rate)
             {
                 if constexpr (Check_Adapter)
@@ -135,13 +148,11 @@ class Trimmer <PAIRED, FORMAT>
                         continue;
                     }
                     
-                    subseq1 = SEQ(fq1.seq.begin() + idx, fq1.seq.end());
-                    subseq2 = SEQ(fq2.seq.begin() + idx, fq2.seq.end());
-                    min_len1 = std::min(subseq1.size(), adapters[0].size());
-                    min_len2 = std::min(subseq2.size(), adapters[1].size());
-                    if ((float)cal_match_num(subseq1, adapters[0], min_len1) 
+                    min_len1 = std::min(fq1.seq.size() - idx, adapters[0].size());
+                    min_len2 = std::min(fq2.seq.size() - idx, adapters[1].size());
+                    if ((float)cal_match_num(fq1.seq, idx, adapters[0], min_len1) 
                         / min_len1 >= trait_parm.adapter_cmp_rate ||
-                        (float)cal_match_num(subseq2, adapters[1], min_len2)
+                        (float)cal_match_num(fq2.seq, idx, adapters[1], min_len2)
                         / min_len2 >= trait_parm.adapter_cmp_rate)
                     {
                         return idx;
@@ -155,21 +166,16 @@ class Trimmer <PAIRED, FORMAT>
             }
         }
         
-        possible_pos1.clear();
-        possible_pos2.clear();
-        
         // if no adapters are detected in the sequence,
         // check if adapters are located at the head of the reads
         if (Check_Adapter && intersect_pos.size() == 0)
         {
-            subseq1 = SEQ(fq1.seq.begin(), fq1.seq.begin() + FLANKING_BASE * 2);
-            size_t pos = find_adapter_pos(subseq1, adapters[0]);
+            size_t pos = find_adapter_pos(fq1.seq, adapters[0]);
             if (pos != -1)
             {
                 return pos;
             }
-            subseq2 = SEQ(fq2.seq.begin(), fq2.seq.begin() + FLANKING_BASE * 2);
-            pos = find_adapter_pos(subseq2, adapters[1]);
+            pos = find_adapter_pos(fq2.seq, adapters[1]);
             if (pos != -1)
             {
                 return pos;
@@ -183,30 +189,63 @@ class Trimmer <PAIRED, FORMAT>
 
 
   private:
+    // buffers of find_rc_pos, kept per thread and reused across read pairs
+    struct Scratch
+    {
+        std::vector<size_t> possible_pos1, possible_pos2, intersect_pos;
+        std::vector<uint64_t> r_seq;
+    };
+
+    static Scratch& scratch()
+    {
+        thread_local Scratch buf;
+        return buf;
+    }
+
+    // WORD_BASE bases of seq from pos, bases past the storage are 0
     template <typename SEQ>
-    SEQ get_rc(const SEQ& seq, const size_t size) const
+    static uint64_t load_word(const SEQ& seq, size_t pos)
     {
-        SEQ reverse_seq(size);
+        const uint64_t* words(seq.data());
+        size_t n_words((seq.size() + WORD_BASE - 1) / WORD_BASE);
+        size_t w(pos / WORD_BASE), shift(pos % WORD_BASE * 2);
+
+        uint64_t lo(w < n_words ? words[w] : 0);
+        if (shift == 0)
+            return lo;
+        uint64_t hi(w + 1 < n_words ? words[w + 1] : 0);
+        return lo >> shift | hi << (64 - shift);
+    }
 
-        for (size_t i(0); i < reverse_seq.size(); i++)
-            reverse_seq[i] = seq[reverse_seq.size() - 1 - i];
-        
-        reverse_seq.flip();
-        return reverse_seq;
+    // ALIGN_BASE bases of seq from pos, shifted out of the packed words
+    template <typename SEQ>
+    static SIMD_Vector load_window(const SEQ& seq, size_t pos)
+    {
+        alignas(ALIGN_BYTE) uint64_t window[ALIGN_BYTE / 8];
+        for (size_t i(0); i < ALIGN_BYTE / 8; i++)
+            window[i] = load_word(seq, pos + i * WORD_BASE);
+        return simdpp::load(window);
+    }
+
+    // reverse complement of the first size bases of seq
+    template <typename SEQ>
+    static void get_rc(uint64_t* rc, const SEQ& seq, const size_t size)
+    {
+        std::copy_n(seq.data(), (size + WORD_BASE - 1) / WORD_BASE, rc);
+        biovoltron::reverse_complement(rc, size);
     }
 
     template<typename SEQ>
-    size_t find_adapter_pos(SEQ &seq, SEQ &seq_adapt) const
+    size_t find_adapter_pos(const SEQ &seq, const SEQ &seq_adapt) const
     {
-        size_t min_len = std::min(seq.size(), (size_t)(FLANKING_BASE * 2));
-        SEQ subseq(seq.begin(), seq.begin() + min_len);
-        SIMD_Vector adapter(simdpp::load(seq_adapt[0].get_seg()))
-                  , seq_buf(simdpp::load(subseq[0].get_seg()));
+        size_t seq_len = std::min(seq.size(), (size_t)(FLANKING_BASE * 2));
+        SIMD_Vector adapter(load_window(seq_adapt, 0))
+                  , seq_buf(load_window(seq, 0));
         
-        size_t match_num;
+        size_t match_num, min_len;
         for (size_t i(0); i < FLANKING_BASE; ++i)
         {
-            min_len = std::min({subseq.size() - i, (size_t)FLANKING_BASE, seq_adapt.size()});
+            min_len = std::min({seq_len - i, (size_t)FLANKING_BASE, seq_adapt.size()});
             if (min_len < trait_parm.adapter_min_len)
                 break;
             auto &mask = erase_mask[min_len];
@@ -228,55 +267,25 @@ class Trimmer <PAIRED, FORMAT>
         return -1;
     }
 
+    // window starts whose FLANKING_BASE bases match the adapter, 
+    // reported as the end of the window, which is the insert length
     template <typename SEQ>
     void find_possible_pos(std::vector<size_t>& possible_pos, 
-	    const SEQ& seq, const SEQ& seq_adapt) const
+	    const SEQ& seq, const SIMD_Vector& adapter) const
     {
-        SIMD_Vector adapter(simdpp::load(seq_adapt[0].get_seg()));
-        SIMD_Vector seq_buf, next_seq_buf;
-        size_t remaining_base;
-        size_t min_len = std::min({seq.size(), (size_t)FLANKING_BASE, seq_adapt.size()});
+        if (seq.size() < FLANKING_BASE)
+            return;
 
-        // if sequence size is smaller than the align base
-        if (seq.size() < ALIGN_BASE)
-        {
-            seq_buf = simdpp::load(seq[0].get_seg());
-            for (auto i(0); i < FLANKING_BASE; ++i)
-            {
-                min_len = std::min({seq.size() - i, (size_t)FLANKING_BASE, seq_adapt.size()});
-                if (min_len < trait_parm.adapter_min_len) break;
-                auto& mask = erase_mask[min_len];
-                auto match_num = fixed_len_cal_match_num<ALIGN_BYTE>(
-                    ~((seq_buf & mask) ^ (adapter | ~mask)), 
-                    std::make_index_sequence<FLANKING_BASE>{}  
-                    );
-                if ((float)match_num / min_len > trait_parm.match_rate)
-                {
-                    possible_pos.emplace_back(i);
-                }
+        SIMD_Vector seq_buf, next_seq_buf;
+        size_t last_pos(seq.size() - FLANKING_BASE), remaining_base;
+        auto& mask = erase_mask[FLANKING_BASE];
 
-                seq_buf = (seq_buf >> 2) | 
-                    simdpp::move16_l<1>(
-                    (seq_buf & extract_mask) << 6
-                    );
-            }
-        }
-        
-        auto& mask = erase_mask[min_len];
-        for (size_t i(0); i < seq.size() / ALIGN_BASE; i++)
+        // windows past the end of seq are zero padded by load_window
+        for (size_t i(0); i <= last_pos; i += ALIGN_BASE)
         {
-            seq_buf = simdpp::load(
-                seq[i * ALIGN_BASE].get_seg()
-            );
-            next_seq_buf = simdpp::load(
-                seq[(i + 1) * ALIGN_BASE].get_seg()
-            );
-
-            if (i == seq.size() / ALIGN_BASE - 1)
-            remaining_base = seq.size() - (i + 1) * ALIGN_BASE 
-                + 1 + (ALIGN_BASE - FLANKING_BASE);
-            else
-            remaining_base = ALIGN_BASE;
+            seq_buf = load_window(seq, i);
+            next_seq_buf = load_window(seq, i + ALIGN_BASE);
+            remaining_base = std::min(last_pos - i + 1, (size_t)ALIGN_BASE);
 
             for (size_t j(0); j < remaining_base; j++)
             {
@@ -284,12 +293,10 @@ class Trimmer <PAIRED, FORMAT>
                     ~((seq_buf & mask) ^ (adapter | ~mask)), 
                     std::make_index_sequence<FLANKING_BYTE>{}  
                     );
-                if ((float)match_num / min_len >= 
+                if ((float)match_num / FLANKING_BASE >= 
                     trait_parm.match_rate)
                 {
-                    possible_pos.emplace_back(
-                        i * ALIGN_BASE + j + FLANKING_BASE
-                    );
+                    possible_pos.emplace_back(i + j + FLANKING_BASE);
                 }
 
                 seq_buf = (seq_buf >> 2) | 
@@ -320,48 +327,44 @@ class Trimmer <PAIRED, FORMAT>
 	return count;
     }
 
-    template <typename SEQ>
-    uint32_t cal_match_num(const SEQ& seq1, const SEQ& seq2, size_t idx) const
+    // matches of the first len bases, load1/load2 give the block from a base
+    template <typename LOAD1, typename LOAD2>
+    uint32_t cal_match_num(LOAD1&& load1, LOAD2&& load2, size_t len) const
     {
-        if (seq1.empty() || seq2.empty())
-        {
-            return 0;
-        }
-        
 		uint32_t match_num(0);
-		SIMD_Vector cmp_buf1, cmp_buf2;
+		size_t i(0);
 
-		for (size_t i(0); i < idx / ALIGN_BASE; i++)
+		for (; i + ALIGN_BASE <= len; i += ALIGN_BASE)
 		{
-			cmp_buf1 = simdpp::load(seq1[i * ALIGN_BASE].get_seg());
-            cmp_buf2 = simdpp::load(seq2[i * ALIGN_BASE].get_seg());
-
             match_num += fixed_len_cal_match_num<ALIGN_BYTE>(
-                ~(cmp_buf1 ^ cmp_buf2),
+                ~(load1(i) ^ load2(i)),
                 std::make_index_sequence<ALIGN_BYTE>{}
                 );
 		}
 
-		auto& mask(
-			erase_mask[idx - idx / ALIGN_BASE * ALIGN_BASE]
-			);
-
-        // idx-1
-		cmp_buf1 = simdpp::load(
-			seq1[idx / ALIGN_BASE * ALIGN_BASE].get_seg()
-			);
-
-        cmp_buf2 = simdpp::load(
-            seq2[idx / ALIGN_BASE * ALIGN_BASE].get_seg()
-        );
-        match_num += fixed_len_cal_match_num<ALIGN_BYTE>(
-            ~((cmp_buf1 & mask) ^ (cmp_buf2 | ~mask)), 
-            std::make_index_sequence<ALIGN_BYTE>{}
-        );
+        if (i < len)
+        {
+            auto& mask(erase_mask[len - i]);
+            match_num += fixed_len_cal_match_num<ALIGN_BYTE>(
+                ~((load1(i) & mask) ^ (load2(i) | ~mask)), 
+                std::make_index_sequence<ALIGN_BYTE>{}
+            );
+        }
         
         return match_num;
     }
 
+    // matches of seq1 from pos1 against the head of seq2 over len bases
+    template <typename SEQ1, typename SEQ2>
+    uint32_t cal_match_num(const SEQ1& seq1, size_t pos1, 
+        const SEQ2& seq2, size_t len) const
+    {
+        return cal_match_num(
+            [&seq1, pos1](size_t i){ return load_window(seq1, pos1 + i); },
+            [&seq2](size_t i){ return load_window(seq2, i); },
+            len);
+    }
+
 };
 
 template <typename FORMAT>
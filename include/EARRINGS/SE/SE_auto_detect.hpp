@@ -6,16 +6,19 @@
 #include <EARRINGS/graph.hpp>
 #include <EARRINGS/common.hpp>
 #include <EARRINGS/assemble_adapters.hpp>
+#include <EARRINGS/detect_convergence.hpp>
 #include <Nucleona/range/v3_impl.hpp>
-#include <Nucleona/parallel/thread_pool.hpp>
-#include <Nucleona/parallel/asio_pool.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <streambuf>
 #include <fstream>
 #include <atomic>
 #include <utility>
+#include <unordered_map>
 
 using namespace EARRINGS;
 namespace EARRINGS
@@ -36,118 +39,167 @@ void get_reads(std::istream& is, std::vector<FORMAT>& buf, size_t num_reads)
 using trueType = std::bool_constant<true>;
 using falseType = std::bool_constant<false>;
 
+/*
+ * Tails of the sampled reads. Identical reads are aligned once: the tails of
+ * the first one are kept, and tail_counts[i] counts the reads tails[i] was
+ * found in. Small RNA and amplicon samples are mostly a few sequences, which
+ * leaves only a small part of the sample to align, on the calling thread.
+ * Reads are taken in batches until DetectConvergence stops the sampling, at
+ * most num_reads reads (0 for no limit) or detect_max_seconds. How many were
+ * used is reported to log.
+ */
 template<class IFStream, class TailorMain>
 std::vector<std::string> tailor_pipeline(IFStream&& ifs
-                                       , size_t thread_num
                                        , TailorMain&& tailor_mapping
-                                       , size_t num_reads) 
+                                       , size_t num_reads
+                                       , std::vector<uint32_t>& tail_counts
+                                       , std::ostream& log) 
 {
     const auto& aligner = tailor_mapping.get_table();
-    const auto& paras = tailor_mapping.get_paras();
-    auto tp = nucleona::parallel::make_asio_pool(thread_num);
-    using DataType = typename std::remove_const_t<std::remove_reference_t<decltype(aligner)>>::FASTQ;
+    using AlignerType = std::remove_const_t<std::remove_reference_t<decltype(aligner)>>;
+    using DataType = typename AlignerType::FASTQ;
     constexpr pipeline::range::format_reader_fn<DataType> format_reader{};  
 
+    // only tail positions are needed, so hits are counted but not located
+    typename AlignerType::Arena arena;
+    arena.locate = false;
+
     std::vector<std::string> tails;
-    tails.reserve(num_reads);
-    size_t counter(0);
-    while(ifs.good() && tails.size() < 3000 && counter < 3)
+    tail_counts.clear();
+    // tails[first, second) of every distinct read
+    std::unordered_map<std::string, std::pair<size_t, size_t>> read_tails;
+    read_tails.reserve(DETECT_BATCH_READS);
+    DetectConvergence<> convergence(num_reads, detect_max_seconds);
+    while(ifs.good())
     {
+        size_t batch_reads(0);
         ifs
-        | format_reader()
-        | pipeline::range::align(aligner)
+        | format_reader(DETECT_BATCH_READS + 1)
         | ranges::view::transform(
-            [&tails](auto&& AlignedReads_v) {
-                for(auto&& i : AlignedReads_v)
+            [&tails, &tail_counts, &read_tails, &convergence, &batch_reads, &aligner, &arena](auto&& fq) {
+                batch_reads++;
+                // reads with n-bases are not aligned, and their random 
+                // replacement bases must not stand for another read
+                if (!fq.n_base_info_table.empty())
+                    return size_t(0);
+
+                auto [it, is_new] = read_tails.try_emplace(fq.seq, tails.size(), tails.size());
+                if (!is_new)
                 {
-                    if (i.tail_pos_ >= 0)
+                    for (auto i = it->second.first; i < it->second.second; ++i)
                     {
-                        tails.emplace_back(i.fq_.seq.substr(i.fq_.seq.length() - i.tail_pos_ - 1));
+                        tail_counts[i]++;
+                        convergence.add_tail(tails[i]);
                     }
+                    return size_t(it->second.second - it->second.first);
                 }
-                return AlignedReads_v;
+
+                aligner.align(fq, arena);
+                for(auto&& i : arena.alignments)
+                {
+                    if (i.tail_pos >= 0)
+                    {
+                        tails.emplace_back(fq.seq.substr(fq.seq.length() - i.tail_pos - 1));
+                        tail_counts.emplace_back(1);
+                        convergence.add_tail(tails.back());
+                    }
+                }
+                it->second.second = tails.size();
+                return size_t(arena.alignments.size());
             }
         )	
         | nucleona::range::endp;
-        counter++;
+
+        if (convergence.update(batch_reads))
+            break;
     }
+    convergence.report(log);
 
     return tails;
 }
 
 
-std::pair<std::string, bool> seat_adapter_auto_detect( 
-                                      std::string& reads_path
-                                    , size_t thread_num = 1
-                                    )
+/*
+ * Input buffer of the integrated single-end pipeline. Detection reads the head
+ * of the opened input through it, and every byte read is kept, so the trimmer
+ * can take the head back and go on with the same file handle afterwards.
+ * The head is capped at max_size bytes: past that, detection sees the end of
+ * input after the last whole record (of record_lines lines) read so far.
+ */
+class sample_streambuf : public std::streambuf
 {
-    std::vector<std::string> tails;
-    if (is_fastq)
+  private:
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+    FILE* fp_;
+    std::string head_;
+    size_t record_lines_;
+    size_t max_size_;
+    size_t lines_ = 0;
+    bool capped_ = false;
+
+  protected:
+    int_type underflow() override
     {
-        tailor::TailorMain<falseType::value> tailor_mapping(thread_num, seed_len, min_multi, index_prefix, !no_mismatch);
-        if (is_gz_input)
+        if (capped_)
+            return traits_type::eof();
+
+        auto begin = head_.size();
+        head_.resize(begin + CHUNK_SIZE);
+        auto n = std::fread(&head_[begin], 1, CHUNK_SIZE, fp_);
+        head_.resize(begin + n);
+        if (n == 0)
+            return traits_type::eof();
+
+        auto end = head_.size();
+        if (end < max_size_)
         {
-            boost::iostreams::filtering_istream ifs;
-
-            ifs.push(boost::iostreams::gzip_decompressor());
-            auto&& src(boost::iostreams::file_source(reads_path, std::ios_base::binary));
-            if (!src.is_open())
-                throw std::runtime_error("Can't open input gz file normally\n");
-            
-            ifs.push(src);
-            if (!ifs.good())
-                throw std::runtime_error("Can't open input gz stream normally\n");
-            
-            tails = tailor_pipeline(ifs, thread_num, tailor_mapping, DETECT_N_READS);
+            lines_ += std::count(head_.begin() + begin, head_.end(), '\n');
         }
         else
         {
-            std::ifstream ifs(reads_path);
-            if (!(ifs.is_open() && ifs.good()))
-                throw std::runtime_error("Can't open input file normally\n");
-            
-            tails = tailor_pipeline(ifs, thread_num, tailor_mapping, DETECT_N_READS);
+            // the rest of the chunk stays in the head for the trimmer only
+            capped_ = true;
+            end = begin;
+            for (auto i = begin; i < head_.size(); ++i)
+            {
+                if (head_[i] == '\n' && ++lines_ % record_lines_ == 0)
+                    end = i + 1;
+            }
+            if (end == begin)
+                return traits_type::eof();
         }
+        setg(head_.data(), head_.data() + begin, head_.data() + end);
+        return traits_type::to_int_type(head_[begin]);
     }
-    else
+
+  public:
+    static constexpr size_t MAX_HEAD_SIZE = size_t(1) << 28;
+
+    sample_streambuf(FILE* fp, size_t record_lines, size_t max_size = MAX_HEAD_SIZE)
+        : fp_(fp)
+        , record_lines_(record_lines)
+        , max_size_(max_size)
+    {}
+
+    const std::string& head() const
     {
-        tailor::TailorMain<trueType::value> tailor_mapping(thread_num, seed_len, min_multi, index_prefix, !no_mismatch);
-        if (is_gz_input)
-        {
-            boost::iostreams::filtering_istream ifs;
-
-            ifs.push(boost::iostreams::gzip_decompressor());
-            auto&& src(boost::iostreams::file_source(reads_path, std::ios_base::binary));
-            if (!src.is_open())
-                throw std::runtime_error("Can't open input gz file normally\n");
-            
-            ifs.push(src);
-            if (!ifs.good())
-                throw std::runtime_error("Can't open input gz stream normally\n");
-            
-            tails = tailor_pipeline(ifs, thread_num, tailor_mapping, DETECT_N_READS);
-        }
-        else
-        {
-            std::ifstream ifs(reads_path);
-            if (!(ifs.is_open() && ifs.good()))
-                throw std::runtime_error("Can't open input file normally\n");
-            
-            tails = tailor_pipeline(ifs, thread_num, tailor_mapping, DETECT_N_READS);
-        }
+        return head_;
     }
+};
 
-    // std::cerr << "total number of tails sampled: " << tails.size() << "\n";
-
+// assemble tails into the adapter, fallback to the default adapter if failed
+std::pair<std::string, bool> tails_to_adapter(std::vector<std::string>& tails
+                                            , const std::vector<uint32_t>& tail_counts)
+{
     std::string adapter;
     std::pair<std::string, bool> adapter_info;
     if (is_sensitive)
     {
-        adapter_info = assemble_adapters<true>(tails, 10, 5);
+        adapter_info = assemble_adapters<true>(tails, tail_counts, 10, 5);
     }
     else
     {
-        adapter_info = assemble_adapters<false>(tails, 10, 3);
+        adapter_info = assemble_adapters<false>(tails, tail_counts, 10, 3);
     }
     adapter = std::get<0>(adapter_info);    
 
@@ -175,4 +227,62 @@ std::pair<std::string, bool> seat_adapter_auto_detect(
 
      return adapter_info;
 }
-}
\ No newline at end of file
+
+std::pair<std::string, bool> tails_to_adapter(std::vector<std::string>& tails)
+{
+    return tails_to_adapter(tails, std::vector<uint32_t>(tails.size(), 1));
+}
+
+std::pair<std::string, bool> seat_adapter_auto_detect(
+                                      std::istream& is
+                                    , size_t thread_num = 1
+                                    , std::ostream& log = std::cout
+                                    )
+{
+    std::vector<std::string> tails;
+    std::vector<uint32_t> tail_counts;
+    if (is_fastq)
+    {
+        tailor::TailorMain<falseType::value> tailor_mapping(thread_num, seed_len, min_multi, index_prefix, !no_mismatch);
+        tails = tailor_pipeline(is, tailor_mapping, detect_max_reads, tail_counts, log);
+    }
+    else
+    {
+        tailor::TailorMain<trueType::value> tailor_mapping(thread_num, seed_len, min_multi, index_prefix, !no_mismatch);
+        tails = tailor_pipeline(is, tailor_mapping, detect_max_reads, tail_counts, log);
+    }
+
+    // std::cerr << "total number of tails sampled: " << tails.size() << "\n";
+
+    return tails_to_adapter(tails, tail_counts);
+}
+
+std::pair<std::string, bool> seat_adapter_auto_detect( 
+                                      std::string& reads_path
+                                    , size_t thread_num = 1
+                                    , std::ostream& log = std::cout
+                                    )
+{
+    if (is_gz_input)
+    {
+        boost::iostreams::filtering_istream ifs;
+
+        ifs.push(boost::iostreams::gzip_decompressor());
+        auto&& src(boost::iostreams::file_source(reads_path, std::ios_base::binary));
+        if (!src.is_open())
+            throw std::runtime_error("Can't open input gz file normally\n");
+        
+        ifs.push(src);
+        if (!ifs.good())
+            throw std::runtime_error("Can't open input gz stream normally\n");
+        
+        return seat_adapter_auto_detect(ifs, thread_num, log);
+    }
+
+    std::ifstream ifs(reads_path);
+    if (!(ifs.is_open() && ifs.good()))
+        throw std::runtime_error("Can't open input file normally\n");
+    
+    return seat_adapter_auto_detect(ifs, thread_num, log);
+}
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <EARRINGS/common.hpp>
+#include <EARRINGS/kmer_hash.hpp>
+#include <EARRINGS/detect_convergence.hpp>
+#include <EARRINGS/SE/SE_auto_detect.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+using namespace EARRINGS;
+namespace EARRINGS
+{
+/*
+ * Index-free single-end adapter detection.
+ * The adapter is the most over-represented k-mer that also marks a left
+ * boundary: bases before the adapter come from the inserts and are random,
+ * while k-mers inside the adapter (or inside genomic repeats) are always
+ * preceded by the same base. Tails run from that seed k-mer to the 3' end of
+ * the read, which is what the alignment-based detection reports as well, and
+ * are assembled by the same assemble_adapters.
+ * Reads are taken in chunks that double in size. After every chunk the seed
+ * is chosen again from all reads so far, and the tails of the chunk are given
+ * to DetectConvergence, which stops the sampling once the seed and its support
+ * are stable, or at most num_reads reads (0 for no limit) or max_seconds.
+ */
+static constexpr size_t KMER_DETECT_SIZE = 12;
+static constexpr size_t KMER_DETECT_CANDIDATES = 64;
+
+// append up to num_reads sequences to seqs, return the number appended
+size_t read_sample_seqs(std::istream& is, std::vector<std::string>& seqs, size_t num_reads)
+{
+    // whole records, so the next call starts at a header line
+    size_t lines = is_fastq ? 4 : 2, n(0);
+    std::string line, seq;
+    for (; n < num_reads; ++n)
+    {
+        for (size_t i(0); i < lines; ++i)
+        {
+            if (!std::getline(is, line))
+                return n;
+            if (i == 1)
+                seq = std::move(line);
+        }
+        seqs.emplace_back(std::move(seq));
+    }
+
+    return n;
+}
+
+// the seed k-mer of the sample, EMPTY_KEY if there is none
+uint64_t find_seed_kmer(const KmerHash<uint32_t>& counts
+                      , size_t total_kmers
+                      , const std::vector<std::vector<uint8_t>>& codes)
+{
+    constexpr auto NO_SEED = KmerHash<uint32_t>::EMPTY_KEY;
+
+    // k-mers far above the uniform expectation
+    double expected = total_kmers / double(uint64_t(1) << (2 * KMER_DETECT_SIZE));
+    size_t min_count = std::max<size_t>(is_sensitive ? 2 : 10, std::ceil(100 * expected));
+    std::vector<std::pair<uint32_t, uint64_t>> candidates;
+    counts.for_each([&candidates, min_count](auto kmer, auto count){
+        if (count >= min_count)
+            candidates.emplace_back(count, kmer);
+    });
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
+    if (candidates.size() > KMER_DETECT_CANDIDATES)
+        candidates.resize(KMER_DETECT_CANDIDATES);
+
+    if (candidates.empty())
+        return NO_SEED;
+
+    // bases in front of each candidate
+    KmerHash<uint32_t> cand_idx(KMER_DETECT_CANDIDATES * 2);
+    for (size_t i(0); i < candidates.size(); ++i)
+        cand_idx[candidates[i].second] = i;
+
+    std::vector<std::array<uint32_t, 5>> prev_base(candidates.size(), {0, 0, 0, 0, 0});
+    for (const auto& code : codes)
+    {
+        for_each_kmer(code, KMER_DETECT_SIZE, [&cand_idx, &prev_base, &code](auto pos, auto kmer){
+            if (pos == 0)
+                return;
+            if (auto idx = cand_idx.find(kmer); idx != nullptr)
+                prev_base[*idx][code[pos - 1]]++;
+        });
+    }
+
+    // the most frequent boundary k-mer. Over-represented k-mers that are not
+    // boundaries are genomic repeats, rRNA or poly-A, tails cut from them
+    // would trim real sequence
+    for (size_t i(0); i < candidates.size(); ++i)
+    {
+        auto& bases = prev_base[i];
+        uint32_t total(0);
+        for (auto n : bases)
+            total += n;
+        auto top = *std::max_element(bases.begin(), bases.end());
+        auto kmer = decode_kmer(candidates[i].second, KMER_DETECT_SIZE);
+        if (total > 0 && top * 2 < total && !detect_low_complexity(kmer, KMER_DETECT_SIZE))
+            return candidates[i].second;
+    }
+
+    return NO_SEED;
+}
+
+// tails from the first occurrence of the seed to the 3' end, of reads [begin, end)
+template<class F>
+void for_each_seed_tail(const std::vector<std::string>& seqs
+                      , const std::vector<std::vector<uint8_t>>& codes
+                      , size_t begin, size_t end, uint64_t seed_kmer, F&& f)
+{
+    if (seed_kmer == KmerHash<uint32_t>::EMPTY_KEY)
+        return;
+
+    for (size_t i(begin); i < end; ++i)
+    {
+        size_t first = seqs[i].size();
+        for_each_kmer(codes[i], KMER_DETECT_SIZE, [&first, seed_kmer](auto pos, auto kmer){
+            if (kmer == seed_kmer && pos < first)
+                first = pos;
+        });
+        if (first < seqs[i].size())
+            f(seqs[i].substr(first));
+    }
+}
+
+std::vector<std::string> kmer_pipeline(std::istream& is
+                                     , size_t num_reads
+                                     , double max_seconds
+                                     , std::ostream& log = std::cout)
+{
+    std::vector<std::string> seqs;
+    std::vector<std::vector<uint8_t>> codes;
+    KmerHash<uint32_t> counts(1 << 20);
+    size_t total_kmers(0);
+    uint64_t seed_kmer(KmerHash<uint32_t>::EMPTY_KEY);
+    DetectConvergence<> convergence(num_reads, max_seconds);
+    while (true)
+    {
+        auto begin = seqs.size();
+        auto chunk = std::max(DETECT_BATCH_READS, begin);
+        if (num_reads != 0)
+            chunk = std::min(chunk, num_reads - begin);
+        auto n = read_sample_seqs(is, seqs, chunk);
+
+        // count k-mers of the chunk
+        codes.resize(seqs.size());
+        for (size_t i(begin); i < seqs.size(); ++i)
+        {
+            encode_2bit(seqs[i], codes[i]);
+            for_each_kmer(codes[i], KMER_DETECT_SIZE, [&counts, &total_kmers](auto, auto kmer){
+                counts[kmer]++;
+                total_kmers++;
+            });
+        }
+
+        seed_kmer = find_seed_kmer(counts, total_kmers, codes);
+        for_each_seed_tail(seqs, codes, begin, seqs.size(), seed_kmer, [&convergence](auto&& tail){
+            convergence.add_tail(tail);
+        });
+
+        if (convergence.update(n) || n < chunk)
+            break;
+    }
+    convergence.report(log);
+
+    std::vector<std::string> tails;
+    for_each_seed_tail(seqs, codes, 0, seqs.size(), seed_kmer, [&tails](auto&& tail){
+        tails.emplace_back(std::move(tail));
+    });
+
+    return tails;
+}
+
+std::pair<std::string, bool> kmer_adapter_auto_detect(std::istream& is, std::ostream& log = std::cout)
+{
+    auto tails = kmer_pipeline(is, detect_max_reads, detect_max_seconds, log);
+    return tails_to_adapter(tails);
+}
+
+std::pair<std::string, bool> kmer_adapter_auto_detect(std::string& reads_path
+                                                     , std::ostream& log = std::cout)
+{
+    if (is_gz_input)
+    {
+        boost::iostreams::filtering_istream ifs;
+
+        ifs.push(boost::iostreams::gzip_decompressor());
+        auto&& src(boost::iostreams::file_source(reads_path, std::ios_base::binary));
+        if (!src.is_open())
+            throw std::runtime_error("Can't open input gz file normally\n");
+
+        ifs.push(src);
+        if (!ifs.good())
+            throw std::runtime_error("Can't open input gz stream normally\n");
+
+        return kmer_adapter_auto_detect(ifs, log);
+    }
+
+    std::ifstream ifs(reads_path);
+    if (!(ifs.is_open() && ifs.good()))
+        throw std::runtime_error("Can't open input file normally\n");
+
+    return kmer_adapter_auto_detect(ifs, log);
+}
+}
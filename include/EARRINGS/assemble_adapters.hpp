@@ -3,11 +3,11 @@
 #include <EARRINGS/common.hpp>
 #include <string>
 #include <vector>
-#include <experimental/vector>
 #include <array>
 #include <string>
 #include <fstream>
 #include <unordered_map>
+#include <cmath>
 
 namespace EARRINGS
 {
@@ -77,79 +77,121 @@ size_t estimate_umi_size(const std::vector<std::string>& tails,
     return max_len;
 }
 
-// max_try is set to 5 in sensitive mode
+// lowering PRUNE_FACTOR until adapters are found, false if it gets too low
 template<bool IS_SENSITIVE>
-std::pair<std::string, bool> assemble_adapters(
-        std::vector<std::string>& tails, 
-        const size_t kmer_size = 10,
-        const size_t max_try = 3)
+bool find_graph_adapters(kyutora::GraphWrapper& g,
+                         const size_t tail_size,
+                         const size_t max_try,
+                         std::vector<std::string>& adapters)
 {
-	std::vector<std::string> adapters;
-    auto original_tails = tails;
-    size_t tail_size = tails.size();
-    kyutora::GraphWrapper g(kmer_size);
-    
     for (size_t i(0); i < max_try; ++i)
     {
-        // removing tails smaller than kmer size
-        std::experimental::erase_if(tails, [&g](const auto& s){return s.size() < g.get_kmer_size();});
-        
         // min_percentage of the adapter: prune_factor / max_try 
         float percentage = (prune_factor / (i + 1));
 
         // lowering PRUNE_FACTOR if adapters not found
-        kyutora::PRUNE_FACTOR = size_t(std::ceil(tail_size * percentage));
+        size_t prune = std::ceil(tail_size * percentage);
         
         // prune factor too low, abort
         if constexpr (!IS_SENSITIVE)
         {
-            if (kyutora::PRUNE_FACTOR < 10)
+            if (prune < 10)
             {
-                return std::make_pair("", false);
+                return false;
             }
         }
         
-        g.build(tails);
+        // the graph used to be rebuilt on top of itself for every try, which
+        // left the edge counts of try i at (i + 1) times the tail support
+        kyutora::PRUNE_FACTOR = (prune + i) / (i + 1);
         // g.print();
-        g.find_sources_and_sinks();
+        g.find_sources();
         g.find_paths();
         adapters = g.get_adapters();
 
-
         if (!adapters.empty()) break; 
     }
 
+    return true;
+}
+
+/*
+ * max_try is set to 5 in sensitive mode
+ * tail_counts[i] is the number of times tails[i] was sampled, a tail is
+ * added to the graphs once and weighted by its count
+ */
+template<bool IS_SENSITIVE>
+std::pair<std::string, bool> assemble_adapters(
+        const std::vector<std::string>& tails, 
+        const std::vector<uint32_t>& tail_counts,
+        const size_t kmer_size = 10,
+        const size_t max_try = 3)
+{
+    // one graph per k-mer size from kmer_size up to MAX_KMER, every tail is
+    // encoded once and fed to all of them
+    std::vector<kyutora::GraphWrapper> graphs;
+    for (size_t k(kmer_size); ; k += 5)
+    {
+        graphs.emplace_back(k);
+        if (k >= MAX_KMER) break;
+    }
 
-    if (adapters.empty())
+    std::vector<uint8_t> codes;
+    size_t tail_num(0);
+    for (size_t i(0); i < tails.size(); ++i)
     {
-        if (kmer_size >= MAX_KMER)
+        encode_2bit(tails[i], codes);
+        for (auto& g : graphs)
         {
-            return std::make_pair("", false);
+            g.add_tail(codes, tail_counts[i]);
         }
-
-        return assemble_adapters<IS_SENSITIVE>(original_tails, kmer_size + 5, max_try);
+        tail_num += tail_counts[i];
     }
-    
-    // increase k-mer when low complexity adapters are assembled
-    if (detect_low_complexity(adapters[0], kmer_size))
+
+    // increase k-mer when no adapter or a low complexity adapter is
+    // assembled, the last low complexity adapter is the fallback
+    std::string low_complexity_adapter;
+    std::vector<std::string> adapters;
+    for (auto& g : graphs)
     {
-        if (kmer_size >= MAX_KMER)
+        g.build();
+        adapters.clear();
+        if (!find_graph_adapters<IS_SENSITIVE>(g, tail_num, max_try, adapters))
         {
-            return std::make_pair(adapters[0], true);
+            break;
         }
-        else
+
+        if (adapters.empty())
         {
-            auto tmp_adapter = std::get<0>(assemble_adapters<IS_SENSITIVE>(original_tails, kmer_size + 5, max_try));
-            if (tmp_adapter.empty())
-            {
-                return std::make_pair(adapters[0], true);
-            }
-            return std::make_pair(tmp_adapter, true);
+            continue;
         }
-    } 
-    
-    return std::make_pair(adapters[0], false); 
+
+        if (detect_low_complexity(adapters[0], g.get_kmer_size()))
+        {
+            low_complexity_adapter = adapters[0];
+            continue;
+        }
+
+        return std::make_pair(adapters[0], !low_complexity_adapter.empty());
+    }
+
+    if (low_complexity_adapter.empty())
+    {
+        return std::make_pair("", false);
+    }
+
+    return std::make_pair(low_complexity_adapter, true);
 }
 
+// every tail sampled once
+template<bool IS_SENSITIVE>
+std::pair<std::string, bool> assemble_adapters(
+        const std::vector<std::string>& tails, 
+        const size_t kmer_size = 10,
+        const size_t max_try = 3)
+{
+    return assemble_adapters<IS_SENSITIVE>(
+        tails, std::vector<uint32_t>(tails.size(), 1), kmer_size, max_try);
+}
 
-}
\ No newline at end of file
+}
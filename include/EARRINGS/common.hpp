@@ -4,6 +4,7 @@
 #include <vector>
 #include <string_view>
 #include <filesystem>
+#include <fstream>
 #include <EARRINGS/version.h>
 
 #define GET_STR(arg)			#arg
@@ -15,8 +16,12 @@ bool is_fastq = true;
 bool is_sensitive = false;
 bool is_gz_input(false), is_gz_output(false);
 bool is_bam(false);
+bool is_stdout_output(false);
+bool is_interleaved_input(false), is_interleaved_output(false);
 size_t record_line = 4;
-constexpr size_t DETECT_N_READS = 10000;
+// budget of the adapter detection, which stops earlier once it converges
+size_t detect_max_reads(100000);
+float detect_max_seconds(30);
 
 // for SE
 std::string index_prefix; 
@@ -25,6 +30,8 @@ size_t min_multi(0);
 float prune_factor(0.1);
 bool no_mismatch(false);
 bool estimate_umi_len(false);
+bool kmer_detect(false);
+size_t buffer_mb(256);  // memory cap of the reads being trimmed, in MB
 
 // for PE
 size_t thread_num(1);
@@ -45,3 +52,32 @@ float match_rate = 0.7, seq_cmp_rate = 0.9, adapter_cmp_rate = 0.8;
 // default adapters
 std::string DEFAULT_ADAPTER1("AGATCGGAAGAGCACACGTCTGAACTCCAGTCAC");
 std::string DEFAULT_ADAPTER2("AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGTA");
+
+// "-" stands for stdin/stdout
+bool is_std_stream(const std::string& fname)
+{
+    return fname == "-";
+}
+
+// detect gzip by its magic bytes (0x1f 0x8b) instead of the file extension,
+// stdin can only be peeked by one byte without consuming it.
+bool is_gz_file(const std::string& fname)
+{
+    if (is_std_stream(fname))
+    {
+        return std::cin.peek() == 0x1f;
+    }
+
+    std::ifstream ifs(fname, std::ios_base::binary);
+    char magic[2] = {0, 0};
+    ifs.read(magic, 2);
+    return ifs.gcount() == 2 && 
+           static_cast<unsigned char>(magic[0]) == 0x1f && 
+           static_cast<unsigned char>(magic[1]) == 0x8b;
+}
+
+// keep stdout clean for the trimmed reads, all messages go to stderr instead
+void redirect_log_to_stderr()
+{
+    std::cout.rdbuf(std::cerr.rdbuf());
+}
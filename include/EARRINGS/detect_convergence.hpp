@@ -0,0 +1,167 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <EARRINGS/kmer_hash.hpp>
+
+namespace EARRINGS
+{
+/*
+ * Stop rule of the adapter detection. Reads are sampled in batches of
+ * DETECT_BATCH_READS, and the tails they give are counted by the k-mer they
+ * start with, which is the head of the adapter for most of them. After every
+ * batch the top k-mer is taken with its support (share of the tails) and its
+ * margin over the runner-up. Detection has converged once there are
+ * DETECT_MIN_TAILS tails and, for every end, the top k-mer is the one of the
+ * last batch with support and margin both within DETECT_TOLERANCE of it.
+ * A clean library gives too few tails for that, so detection also stops after
+ * DETECT_NO_ADAPTER_READS reads once, for every end, there are fewer than
+ * DETECT_MIN_TAILS tails and the tails per read are below
+ * DETECT_NO_ADAPTER_RATE after this batch and the last one.
+ * Otherwise it goes on until the read or time budget is used up.
+ */
+static constexpr size_t DETECT_BATCH_READS = 2000;
+static constexpr size_t DETECT_MIN_TAILS = 1000;
+static constexpr size_t DETECT_KMER_SIZE = 12;
+static constexpr double DETECT_TOLERANCE = 0.01;
+static constexpr size_t DETECT_NO_ADAPTER_READS = 10000;
+static constexpr double DETECT_NO_ADAPTER_RATE = 0.01;
+
+template<size_t ENDS = 1>
+class DetectConvergence
+{
+  public:
+    // max_reads == 0 or max_seconds == 0 leaves that budget unlimited
+    DetectConvergence(size_t max_reads, double max_seconds)
+        : _max_reads(max_reads)
+        , _max_seconds(max_seconds)
+        , _start(std::chrono::steady_clock::now())
+    {}
+
+    // a tail of end, sampled count times, tails shorter than the k-mer are not counted
+    void add_tail(const std::string& tail, size_t end = 0, uint32_t count = 1)
+    {
+        auto& e = _ends[end];
+        e.tails += count;
+        if (tail.size() < DETECT_KMER_SIZE)
+        {
+            return;
+        }
+
+        encode_2bit(std::string_view(tail).substr(0, DETECT_KMER_SIZE), _codes);
+        uint64_t kmer(0);
+        for (auto code : _codes)
+        {
+            if (code == KMER_BREAK)
+            {
+                return;
+            }
+            kmer = kmer << 2 | code;
+        }
+        e.support[kmer] += count;
+    }
+
+    // close a batch of n reads, true if detection can stop
+    bool update(size_t n)
+    {
+        _reads += n;
+
+        bool converged(true), no_adapter(_reads >= DETECT_NO_ADAPTER_READS);
+        for (auto& e : _ends)
+        {
+            uint64_t top(0), second(0), top_kmer(KmerHash<uint32_t>::EMPTY_KEY);
+            e.support.for_each([&top, &second, &top_kmer](auto kmer, auto count){
+                if (count > top)
+                {
+                    second = top;
+                    top = count;
+                    top_kmer = kmer;
+                }
+                else if (count > second)
+                {
+                    second = count;
+                }
+            });
+
+            double support = e.tails == 0 ? 0 : double(top) / e.tails;
+            double margin = e.tails == 0 ? 0 : double(top - second) / e.tails;
+            converged = converged && e.tails >= DETECT_MIN_TAILS && top_kmer == e.top_kmer
+                     && std::abs(support - e.top_support) < DETECT_TOLERANCE
+                     && std::abs(margin - e.top_margin) < DETECT_TOLERANCE;
+            e.top_kmer = top_kmer;
+            e.top_support = support;
+            e.top_margin = margin;
+
+            double rate = _reads == 0 ? 0 : double(e.tails) / _reads;
+            no_adapter = no_adapter && e.tails < DETECT_MIN_TAILS && rate < DETECT_NO_ADAPTER_RATE
+                      && e.tail_rate < DETECT_NO_ADAPTER_RATE;
+            e.tail_rate = rate;
+        }
+        _converged = converged;
+        _no_adapter = !converged && no_adapter;
+
+        return _converged || _no_adapter
+            || (_max_reads != 0 && _reads >= _max_reads)
+            || (_max_seconds != 0 && seconds() >= _max_seconds);
+    }
+
+    size_t reads() const
+    {
+        return _reads;
+    }
+
+    bool converged() const
+    {
+        return _converged;
+    }
+
+    // too few tails to hold an adapter
+    bool no_adapter() const
+    {
+        return _no_adapter;
+    }
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+    void report(std::ostream& os) const
+    {
+        os << "adapter detection used " << _reads << " reads (";
+        for (size_t i(0); i < ENDS; ++i)
+        {
+            os << (i == 0 ? "" : ", ") << _ends[i].tails << " tails, support "
+               << _ends[i].top_support << ", margin " << _ends[i].top_margin;
+        }
+        os << ") in " << seconds() << " s, "
+           << (_converged ? "converged"
+             : _no_adapter ? "too few tails, no adapter expected"
+             : "stopped by budget or end of input") << '\n';
+    }
+
+  private:
+    struct End
+    {
+        KmerHash<uint32_t> support;
+        size_t tails = 0;
+        uint64_t top_kmer = KmerHash<uint32_t>::EMPTY_KEY;
+        double top_support = 0;
+        double top_margin = 0;
+        double tail_rate = 1;
+    };
+
+    std::array<End, ENDS> _ends;
+    std::vector<uint8_t> _codes;
+    size_t _reads = 0;
+    size_t _max_reads;
+    double _max_seconds;
+    bool _converged = false;
+    bool _no_adapter = false;
+    std::chrono::steady_clock::time_point _start;
+};
+}
@@ -6,51 +6,46 @@
 #include <string_view>
 #include <limits>
 #include <vector>
-#include <map>
+#include <array>
+#include <algorithm>
+#include <queue>
+#include <tuple>
 #include <iostream>
 #include <fstream>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/filtered_graph.hpp>
+#include <EARRINGS/kmer_hash.hpp>
 
 namespace kyutora
 {
 
 static auto PRUNE_FACTOR = 50;
 
-struct VertexProperty {
-    std::string_view kmer;
-};
+using Kmer = EARRINGS::LongKmer;
+using Vertex = uint32_t;
+using Path = std::vector<Vertex>;
 
-struct EdgeProperty {
-    std::size_t count = 0;
-    double score = std::numeric_limits<double>::lowest();
-};
+static constexpr Vertex NO_VERTEX = std::numeric_limits<Vertex>::max();
 
 /*
- * adjacency lis:
- * OutEdgeList: vecS (std::vector)
- * VertexList: vecS 
- *
+ * Every vertex holds a 2-bit packed k-mer and its out edges inline, indexed
+ * by the base appended to the k-mer, so a vertex has at most 4 out edges.
+ * order keeps the bases in the order their edges were created.
  */
-using Graph = boost::adjacency_list<
-    boost::vecS, boost::vecS, boost::bidirectionalS,
-    VertexProperty, EdgeProperty>;
-using Vertex = boost::graph_traits<Graph>::vertex_descriptor;
-using Edge = boost::graph_traits<Graph>::edge_descriptor;
-using Path = std::vector<Vertex>;
-
-struct cycle_detector : public boost::dfs_visitor<>
-{
-    cycle_detector(bool& has_cycle) : _has_cycle(has_cycle) {}
-    template <class Edge, class Graph>
-    void back_edge(Edge, Graph&) {
-        _has_cycle = true;
-    }
-protected:
-    bool& _has_cycle;
+struct VertexProperty {
+    Kmer kmer = 0;
+    std::array<Vertex, 4> next = {NO_VERTEX, NO_VERTEX, NO_VERTEX, NO_VERTEX};
+    std::array<uint32_t, 4> count = {0, 0, 0, 0};
+    std::array<uint8_t, 4> order = {0, 0, 0, 0};
+    uint8_t out_degree = 0;
 };
 
+/*
+ * graph:
+ * vertices are kept in a flat vector, vertex descriptor is the index
+ * unique k-mers are looked up by an open-addressing hash on the packed k-mer
+ * edges with count < PRUNE_FACTOR are ignored by sources and paths
+ *
+ */
+using Graph = std::vector<VertexProperty>;
 
 class GraphWrapper
 {
@@ -58,184 +53,182 @@ private:
     size_t kmer_size;
 public:
     static constexpr auto NUM_PATHS = 32;
+    static constexpr auto MAX_SEARCH_STEPS = 1u << 16;
     //static constexpr auto KMER_SIZE = 10;
-    
-    static auto get_dup_kmers(std::string_view seq, std::size_t size)
-    {
-        std::set<std::string_view> all_kmers, dup_kmers;
-        for (std::size_t i = 0; i <= seq.size()-size; i++)
-        {
-            auto kmer = seq.substr(i, size);
-            if (auto [iter, success] = all_kmers.insert(kmer); !success)
-                dup_kmers.insert(kmer);
-        }
-        return dup_kmers;
-    }
 
     GraphWrapper(size_t kmer_size = 10): kmer_size(kmer_size) {}
     size_t get_kmer_size() { return kmer_size;  }
 // private:
     Graph g;
     std::vector<Path> paths;
-    struct EdgeFilter
-    {
-        bool operator()(Edge e) const
-        { return (*g)[e].count >= PRUNE_FACTOR; }
-        bool operator()(Vertex v) const
-        {
-            for (auto e : boost::make_iterator_range(boost::out_edges(v, *g)))
-                if ((*g)[e].count >= PRUNE_FACTOR)
-                    return true;
-            for (auto e : boost::make_iterator_range(boost::in_edges(v, *g)))
-                if ((*g)[e].count >= PRUNE_FACTOR)
-                    return true;
-            return false;
-        }
-        Graph* g;
-    } filter{&g};
-
-    boost::filtered_graph<Graph, EdgeFilter, EdgeFilter> fg = {g, filter, filter};
-    std::vector<Vertex> sources, sinks;
-    std::set<std::string_view> dup_kmers;
-    std::map<std::string_view, Vertex> unique_kmers;
+    std::vector<Vertex> sources;
+    std::vector<uint32_t> in_degrees;
+    EARRINGS::KmerHash<uint8_t, Kmer> dup_kmers;
+    EARRINGS::KmerHash<Vertex, Kmer> unique_kmers;
+    // packed tails waiting for build()
+    std::vector<Kmer> kmers, tail_kmers;
+    std::vector<size_t> chains;
+    // number of times the tail of each chain was sampled
+    std::vector<uint32_t> chain_counts;
 // private:
-    auto is_source(Vertex v) const
+    static bool is_kept(uint32_t count)
     {
-        if (boost::in_degree(v, fg) == 0)
-            for (auto e : boost::make_iterator_range(boost::out_edges(v, fg)))
-                if (g[e].count >= PRUNE_FACTOR)
-                    return true;
-        return false;
+        return count >= static_cast<uint32_t>(PRUNE_FACTOR);
     }
 
-    auto is_sink(Vertex v) const
+    bool has_kept_out_edge(Vertex v) const
     {
-        if (boost::out_degree(v, fg) == 0)
-            for (auto e : boost::make_iterator_range(boost::in_edges(v, fg)))
-                if (g[e].count >= PRUNE_FACTOR)
-                    return true;
+        for (auto i = 0u; i < g[v].out_degree; i++)
+            if (is_kept(g[v].count[g[v].order[i]]))
+                return true;
         return false;
     }
 
-    auto find_sources_and_sinks()
+    auto find_sources()
     {
-        for (auto v : boost::make_iterator_range(boost::vertices(fg)))
-        {
-            if (is_source(v)) sources.push_back(v);
-            if (is_sink(v)) sinks.push_back(v);
-        }
-    }
-
-    auto create_edge(Vertex u, Vertex v)
-    {
-        auto [e, success] = boost::add_edge(u, v, g);
-        g[e].count++;
+        sources.clear();
+
+        // in-degree over kept edges only
+        in_degrees.assign(g.size(), 0);
+        for (const auto& u : g)
+            for (auto i = 0u; i < u.out_degree; i++)
+                if (is_kept(u.count[u.order[i]]))
+                    in_degrees[u.next[u.order[i]]]++;
+
+        for (Vertex v = 0; v < g.size(); v++)
+            if (in_degrees[v] == 0 && has_kept_out_edge(v))
+                sources.push_back(v);
     }
 
-    auto create_vertex(std::string_view kmer)
+    auto create_vertex(Kmer kmer)
     {
-        auto v = boost::add_vertex(g);
-        g[v].kmer = kmer; // add new vertex
-        if (dup_kmers.find(kmer) == dup_kmers.end())
-            unique_kmers.emplace(kmer, v);
+        Vertex v = g.size();
+        g.emplace_back().kmer = kmer; // add new vertex
+        if (dup_kmers.find(kmer) == nullptr)
+            unique_kmers[kmer] = v;
         return v;
     }
 
     // create new vertex if not exist
-    auto get_vertex(std::string_view kmer)
+    auto get_vertex(Kmer kmer)
     {
-        if (auto it = unique_kmers.find(kmer); it != unique_kmers.end())
-            return it->second;  // return vertex given string
+        if (auto v = unique_kmers.find(kmer); v != nullptr)
+            return *v;  // return vertex given k-mer
         return create_vertex(kmer);
     }
 
-    auto extend_chain(Vertex u, std::string_view kmer)
+    auto extend_chain(Vertex u, Kmer kmer, uint32_t count)
     {
-        // get iterator's out edges of a given vertices
-        for (auto e : boost::make_iterator_range(boost::out_edges(u, g)))
+        // every vertex contains only one new base (except for the source vertex)
+        auto base = static_cast<uint8_t>(kmer & 3);
+        if (g[u].next[base] != NO_VERTEX)
         {
-            // given an edge, get the targeting vertex that the edge is pointing to 
-            auto v = boost::target(e, g);
-            // every vertex contains only one character (except for the source vertex)
-            if (g[v].kmer.back() == kmer.back())
-            {
-                g[e].count++;
-                return v;
-            }
+            g[u].count[base] += count;
+            return g[u].next[base];
         }
 
+        // get_vertex may reallocate g
         auto v = get_vertex(kmer);
-        create_edge(u, v);
+        g[u].next[base] = v;
+        g[u].count[base] = count;
+        g[u].order[g[u].out_degree++] = base;
         return v;
     }
 
-    void add_seq(std::string_view seq)
+    void add_chain(const Kmer* first, const Kmer* last, uint32_t count)
     {
         // create source vertex if not exist
-        auto v = get_vertex(seq.substr(0, kmer_size));
+        auto v = get_vertex(*first);
         // for every k-mer, extending it
-        for (auto i = 1u; i <= seq.size()-kmer_size; i++)
-            v = extend_chain(v, seq.substr(i, kmer_size));
+        for (++first; first != last; ++first)
+            v = extend_chain(v, *first, count);
     }
 
-    void path_finder(Vertex from, Vertex to, Path& path)
+    // partial path of find_paths, linked to its parent step
+    struct Step
     {
-        path.push_back(from);
-        if (from == to)
-            paths.push_back(path);
-        else
+        Vertex v;
+        uint32_t parent;
+    };
+
+    /*
+     * ordering of partial paths: count of the first edge of the source, then
+     * the weakest edge so far, then the longer one; the earlier step wins ties
+     */
+    struct Candidate
+    {
+        uint32_t support, width, depth, step;
+        bool operator<(const Candidate& rhs) const
         {
-            for (auto e : boost::make_iterator_range(boost::out_edges(from, fg)))
-            {
-                auto v = target(e, fg);
-                if (std::find(path.begin(), path.end(), v) == path.end())
-                    path_finder(v, to, path);
-            }
+            return std::tie(support, width, depth, rhs.step) <
+                   std::tie(rhs.support, rhs.width, rhs.depth, step);
         }
-        path.pop_back();
+    };
+
+    bool on_path(const std::vector<Step>& steps, uint32_t step, Vertex v) const
+    {
+        for (; step != NO_VERTEX; step = steps[step].parent)
+            if (steps[step].v == v)
+                return true;
+        return false;
     }
 
+    /*
+     * best-first search over kept edges from all sources at once. Extending a
+     * path never raises its support or width, so paths reach a sink in
+     * non-increasing (support, width) order. Among paths of equal width a
+     * longer one ranks higher, so there the search goes depth-first rather
+     * than by final rank. At most MAX_SEARCH_STEPS partial paths are expanded.
+     */
     void find_paths()
     {
-        for (auto &i : sources)
+        paths.clear();
+        std::vector<Step> steps;
+        std::priority_queue<Candidate> queue;
+        for (auto v : sources)
         {
-            for (auto &j : sinks)
+            auto support = g[v].count[g[v].order[0]];
+            queue.push({support, std::numeric_limits<uint32_t>::max(), 1, uint32_t(steps.size())});
+            steps.push_back({v, NO_VERTEX});
+        }
+
+        for (auto n = 0u; !queue.empty() && paths.size() < NUM_PATHS && n < MAX_SEARCH_STEPS; n++)
+        {
+            auto c = queue.top();
+            queue.pop();
+            auto u = steps[c.step].v;
+
+            if (!has_kept_out_edge(u))
+            {
+                Path path(c.depth);
+                for (auto i = c.step; i != NO_VERTEX; i = steps[i].parent)
+                    path[--c.depth] = steps[i].v;
+                paths.emplace_back(std::move(path));
+                continue;
+            }
+
+            for (auto i = 0u; i < g[u].out_degree; i++)
             {
-                Path path;
-                path_finder(i, j, path);
+                auto base = g[u].order[i];
+                auto count = g[u].count[base];
+                auto v = g[u].next[base];
+                if (!is_kept(count) || on_path(steps, c.step, v))
+                    continue;
+                queue.push({c.support, std::min(c.width, count), c.depth + 1, uint32_t(steps.size())});
+                steps.push_back({v, c.step});
             }
         }
     }
 
+    // paths are ranked by find_paths already
     auto get_adapters()
     {
         std::vector<std::string> adapters;
-        // sort according to the count of source vertex
-        std::sort(paths.begin(), paths.end(),
-                [this](const auto& lhs, const auto& rhs)
-                {
-                    // lhs[0]/rhs[0] -> source
-                    for (auto lhs_e : boost::make_iterator_range(boost::out_edges(lhs[0], g)))
-                    {
-                        for (auto rhs_e : boost::make_iterator_range(boost::out_edges(rhs[0], g)))
-                        {
-                            return g[lhs_e].count > g[rhs_e].count;
-                        }
-                    }
-
-                    //return lhs.size() > rhs.size();
-                }); 
-        
         for (const auto& path : paths)
         {
-            auto u = path[0];
-            auto seq = std::string{g[u].kmer.data(), g[u].kmer.size()};
+            auto seq = EARRINGS::decode_kmer(g[path[0]].kmer, kmer_size);
             for (std::size_t i = 1; i < path.size(); i++)
-            {
-                auto v = path[i];
-                seq += g[v].kmer.back();
-                u = v;
-            }
+                seq += EARRINGS::KMER_BASES[g[path[i]].kmer & 3];
             adapters.emplace_back(std::move(seq));
         }
 
@@ -244,46 +237,118 @@ public:
 
 
 public:
+    /*
+     * pack the k-mers of one encoded tail, a chain is a run of k-mers without
+     * N inside. A tail sampled count times is added once, its edges are
+     * counted count times.
+     */
+    void add_tail(const std::vector<uint8_t>& codes, uint32_t count = 1)
+    {
+        auto begin = kmers.size();
+        auto next_pos = std::numeric_limits<size_t>::max();
+        EARRINGS::for_each_kmer<Kmer>(codes, kmer_size,
+            [this, &next_pos, count](auto pos, auto kmer){
+                if (pos != next_pos)
+                {
+                    chains.push_back(kmers.size());
+                    chain_counts.push_back(count);
+                }
+                kmers.push_back(kmer);
+                next_pos = pos + 1;
+            });
+
+        // non-unique kmers of this tail
+        tail_kmers.assign(kmers.begin() + begin, kmers.end());
+        std::sort(tail_kmers.begin(), tail_kmers.end());
+        for (size_t i = 1; i < tail_kmers.size(); i++)
+            if (tail_kmers[i] == tail_kmers[i - 1])
+                dup_kmers[tail_kmers[i]] = 1;
+    }
+
+    // build graph from the tails added so far
+    void build()
+    {
+        chains.push_back(kmers.size());
+        for (size_t i = 0; i + 1 < chains.size(); i++)
+            add_chain(kmers.data() + chains[i], kmers.data() + chains[i + 1], chain_counts[i]);
+
+        kmers = {};
+        chains = {};
+        chain_counts = {};
+        tail_kmers = {};
+    }
+
     // build graph from tails
     void build(const std::vector<std::string>& seqs)
     {
-        // get non-unique kmers from all tails
-        for (const auto& seq : seqs)
-            for (auto kmer : get_dup_kmers(seq, kmer_size))
-                dup_kmers.insert(kmer);
-
+        std::vector<uint8_t> codes;
         for (const auto& seq : seqs)
-            add_seq(seq);
+        {
+            EARRINGS::encode_2bit(seq, codes);
+            add_tail(codes);
+        }
+        build();
     }
 
     bool has_cycles() const
     {
-        bool has_cycle = false;
-        cycle_detector vis(has_cycle);
-        boost::depth_first_search(g, boost::visitor(vis));
-        return has_cycle;
+        // iterative dfs, a back edge points to a vertex still on the stack
+        enum { WHITE, GREY, BLACK };
+        std::vector<uint8_t> color(g.size(), WHITE);
+        std::vector<std::pair<Vertex, uint8_t>> stack;
+        for (Vertex s = 0; s < g.size(); s++)
+        {
+            if (color[s] != WHITE)
+                continue;
+            color[s] = GREY;
+            stack.emplace_back(s, 0);
+            while (!stack.empty())
+            {
+                auto& [u, i] = stack.back();
+                if (i == g[u].out_degree)
+                {
+                    color[u] = BLACK;
+                    stack.pop_back();
+                    continue;
+                }
+                auto v = g[u].next[g[u].order[i++]];
+                if (color[v] == GREY)
+                    return true;
+                if (color[v] == WHITE)
+                {
+                    color[v] = GREY;
+                    stack.emplace_back(v, 0);
+                }
+            }
+        }
+        return false;
     }
 
     void print() const
     {
         std::ofstream os("graph.dot");
         os << "digraph assembly_graphs {";
-        for (auto e : boost::make_iterator_range(boost::edges(fg)))
+        std::vector<bool> has_in(g.size(), false);
+        for (Vertex u = 0; u < g.size(); u++)
         {
-            os << boost::source(e, fg) << " -> " << boost::target(e, fg) << " ";
-            auto count = fg[e].count;
-            if (count < PRUNE_FACTOR)
-                 os << "[label=" << count << ",style=dotted,color=grey];\n";
-            else os << "[label=" << count << "];\n";
+            for (auto i = 0u; i < g[u].out_degree; i++)
+            {
+                auto base = g[u].order[i];
+                has_in[g[u].next[base]] = true;
+                os << u << " -> " << g[u].next[base] << " ";
+                auto count = g[u].count[base];
+                if (!is_kept(count))
+                     os << "[label=" << count << ",style=dotted,color=grey];\n";
+                else os << "[label=" << count << "];\n";
+            }
         }
 
-        for (auto v : boost::make_iterator_range(boost::vertices(fg)))
+        for (Vertex v = 0; v < g.size(); v++)
         {
             os << v << " ";
-            auto kmer = fg[v].kmer;
-            if (boost::in_degree(v, fg) == 0)
-                 os << "[label=" << kmer << ",shape=box]\n";
-            else os << "[label=" << kmer.back() << ",shape=box]\n";
+            if (!has_in[v])
+                 os << "[label=" << EARRINGS::decode_kmer(g[v].kmer, kmer_size) << ",shape=box]\n";
+            else os << "[label=" << EARRINGS::KMER_BASES[g[v].kmer & 3] << ",shape=box]\n";
         }
         os << "}";
     }
@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <simdpp/simd.h>
+
+namespace EARRINGS
+{
+/*
+ * 2-bit k-mer utilities shared by the k-mer based adapter detection and the
+ * adapter assembly graph. A base is coded as ((c >> 1) & 3), which maps
+ * A/C/T/G (either case) to 0/1/2/3. Any other character gets KMER_BREAK and
+ * splits the k-mers around it. K-mers up to MAX_KMER_SIZE fit in uint64_t,
+ * longer ones (up to MAX_LONG_KMER_SIZE) are packed into LongKmer.
+ */
+using LongKmer = unsigned __int128;
+static constexpr uint8_t KMER_BREAK = 4;
+static constexpr size_t MAX_KMER_SIZE = 31;
+static constexpr size_t MAX_LONG_KMER_SIZE = 63;
+static constexpr std::string_view KMER_BASES = "ACTG";
+
+void encode_2bit(std::string_view seq, std::vector<uint8_t>& codes)
+{
+    using SIMD_Vector = simdpp::uint8<16>;
+    codes.resize(seq.size());
+
+    const SIMD_Vector case_mask = simdpp::make_uint(0xDF)
+                    , code_mask = simdpp::make_uint(3)
+                    , break_code = simdpp::make_uint(KMER_BREAK)
+                    , base_a = simdpp::make_uint('A')
+                    , base_c = simdpp::make_uint('C')
+                    , base_g = simdpp::make_uint('G')
+                    , base_t = simdpp::make_uint('T');
+    size_t i(0);
+    for (; i + 16 <= seq.size(); i += 16)
+    {
+        SIMD_Vector c = simdpp::load_u(seq.data() + i);
+        SIMD_Vector upper = c & case_mask;
+        auto is_base = simdpp::cmp_eq(upper, base_a) | simdpp::cmp_eq(upper, base_c) |
+                       simdpp::cmp_eq(upper, base_g) | simdpp::cmp_eq(upper, base_t);
+        SIMD_Vector code = (c >> 1) & code_mask;
+        code = simdpp::blend(code, break_code, is_base);
+        simdpp::store_u(codes.data() + i, code);
+    }
+
+    for (; i < seq.size(); ++i)
+    {
+        switch (seq[i] & 0xDF)
+        {
+            case 'A': case 'C': case 'G': case 'T':
+                codes[i] = (seq[i] >> 1) & 3;
+                break;
+            default:
+                codes[i] = KMER_BREAK;
+        }
+    }
+}
+
+template<class KMER = uint64_t>
+std::string decode_kmer(KMER kmer, size_t kmer_size)
+{
+    std::string seq(kmer_size, 'N');
+    for (size_t i(kmer_size); i > 0; --i, kmer >>= 2)
+    {
+        seq[i - 1] = KMER_BASES[kmer & 3];
+    }
+    return seq;
+}
+
+// call f(pos, kmer) for every k-mer without a break inside, pos is its start
+template<class KMER = uint64_t, class F>
+void for_each_kmer(const std::vector<uint8_t>& codes, size_t kmer_size, F&& f)
+{
+    const KMER mask = (KMER(1) << (kmer_size * 2)) - 1;
+    KMER kmer(0);
+    size_t len(0);
+    for (size_t i(0); i < codes.size(); ++i)
+    {
+        if (codes[i] == KMER_BREAK)
+        {
+            len = 0;
+            continue;
+        }
+        kmer = ((kmer << 2) | codes[i]) & mask;
+        if (++len >= kmer_size)
+        {
+            f(i + 1 - kmer_size, kmer);
+        }
+    }
+}
+
+/*
+ * Open-addressing hash table keyed by 2-bit packed k-mers (uint64_t, or
+ * LongKmer for k > 31), with linear probing and fibonacci hashing. Keys and
+ * values are kept in flat arrays, the table doubles when it is half full.
+ */
+template<class VALUE = uint32_t, class KEY = uint64_t>
+class KmerHash
+{
+  public:
+    static constexpr KEY EMPTY_KEY = ~KEY(0);
+
+    KmerHash(size_t capacity = 1024)
+    {
+        reset(capacity);
+    }
+
+    VALUE& operator[](KEY kmer)
+    {
+        if ((_size + 1) * 2 > _keys.size())
+        {
+            grow();
+        }
+        auto i = probe(kmer);
+        if (_keys[i] == EMPTY_KEY)
+        {
+            _keys[i] = kmer;
+            _size++;
+        }
+        return _values[i];
+    }
+
+    VALUE* find(KEY kmer)
+    {
+        auto i = probe(kmer);
+        return _keys[i] == EMPTY_KEY ? nullptr : &_values[i];
+    }
+
+    const VALUE* find(KEY kmer) const
+    {
+        auto i = probe(kmer);
+        return _keys[i] == EMPTY_KEY ? nullptr : &_values[i];
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    void clear()
+    {
+        std::fill(_keys.begin(), _keys.end(), EMPTY_KEY);
+        std::fill(_values.begin(), _values.end(), VALUE());
+        _size = 0;
+    }
+
+    // call f(kmer, value) for every stored k-mer
+    template<class F>
+    void for_each(F&& f) const
+    {
+        for (size_t i(0); i < _keys.size(); ++i)
+        {
+            if (_keys[i] != EMPTY_KEY)
+            {
+                f(_keys[i], _values[i]);
+            }
+        }
+    }
+
+  private:
+    std::vector<KEY> _keys;
+    std::vector<VALUE> _values;
+    size_t _size;
+    size_t _shift;
+
+    void reset(size_t capacity)
+    {
+        size_t bits(4);
+        while ((size_t(1) << bits) < capacity)
+        {
+            bits++;
+        }
+        _keys.assign(size_t(1) << bits, EMPTY_KEY);
+        _values.assign(size_t(1) << bits, VALUE());
+        _size = 0;
+        _shift = 64 - bits;
+    }
+
+    size_t probe(KEY kmer) const
+    {
+        size_t mask = _keys.size() - 1;
+        uint64_t key = uint64_t(kmer);
+        if constexpr (sizeof(KEY) > sizeof(uint64_t))
+        {
+            key ^= uint64_t(kmer >> 64);
+        }
+        size_t i = (key * 0x9E3779B97F4A7C15ull) >> _shift;
+        while (_keys[i] != EMPTY_KEY && _keys[i] != kmer)
+        {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow()
+    {
+        auto keys = std::move(_keys);
+        auto values = std::move(_values);
+        reset(keys.size() * 2);
+        for (size_t i(0); i < keys.size(); ++i)
+        {
+            if (keys[i] != EMPTY_KEY)
+            {
+                auto j = probe(keys[i]);
+                _keys[j] = keys[i];
+                _values[j] = std::move(values[i]);
+                _size++;
+            }
+        }
+    }
+};
+}
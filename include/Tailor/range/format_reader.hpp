@@ -15,7 +15,8 @@ struct format_reader
 private:
     static std::mutex input_mutex;
     friend ranges::range_access;
-    static constexpr auto pool_size_ = 10001;
+    static constexpr std::size_t default_pool_size_ = 10001;
+    std::size_t pool_size_;
     std::size_t count_;
     std::istream* sin_;
     //ranges::semiregular_box_t<Val> obj_;
@@ -40,7 +41,7 @@ private:
         }
         bool equal(ranges::default_sentinel) const
         {
-            return !rng_->sin_ || rng_->count_ == format_reader::pool_size_;
+            return !rng_->sin_ || rng_->count_ == rng_->pool_size_;
         }
         bool equal(cursor that) const
         {
@@ -63,8 +64,9 @@ private:
 
 public:
     format_reader() = default;
-    format_reader(std::istream& sin)
-      : sin_(&sin), obj_{}, count_{0}
+    // the last record read of a pool is not delivered
+    format_reader(std::istream& sin, std::size_t pool_size = default_pool_size_)
+      : pool_size_(pool_size), count_{0}, sin_(&sin), obj_{}
     {
         this->next();
     }
@@ -93,6 +95,13 @@ struct format_reader_fn
             return format_reader<Val>{sin};
         });
     }
+
+    auto operator()(std::size_t pool_size) const
+    {
+        return ranges::make_pipeable([pool_size](std::istream& sin){
+            return format_reader<Val>{sin, pool_size};
+        });
+    }
 };
 
 template <class Val>
@@ -28,6 +28,63 @@ public:
   static constexpr std::array<std::uint8_t, 4> ch_set {'A', 'C', 'G', 'T'};
   static constexpr bool IsRC = true;
 
+  /*
+   * One alignment of a read. Its hits are real_pos[hit_begin, hit_end) and
+   * chr_ids[hit_begin, hit_end) of the arena that holds it, chr_ids index
+   * the chr_names of the index. hit_num is the number of hits, which is
+   * also filled when the hits are not located.
+   */
+  struct Alignment
+  {
+    std::uint16_t flag;
+    int tail_pos;
+    FMIdxRange range;
+    IndexType prefix_match_len;
+    bool has_seed_mismatch;
+    bool has_tail_mismatch;
+    Mismatchtype seed_mismatch;
+    Mismatchtype tail_mismatch;
+    std::size_t hit_begin;
+    std::size_t hit_end;
+    IndexType hit_num;
+  };
+
+  /*
+   * Results of the last align() into it plus the buffers of the search. 
+   * Keep one per thread and reuse it, so aligning a read allocates nothing
+   * once the buffers have grown to the largest read.
+   *
+   * With locate off (detection mode) hits are never resolved to genome
+   * positions. Mappability and min_multi are decided by the widths of the
+   * BWT ranges, and the alignments only carry tail_pos, range and hit_num.
+   * Hits that locating would drop, those across a chromosome boundary or
+   * an n-base region, are counted as well.
+   */
+  struct Arena
+  {
+    bool locate = true;
+
+    std::vector<Alignment> alignments;
+    std::vector<IndexType> real_pos;
+    std::vector<std::uint32_t> chr_ids;
+
+    SEQ rc_query;
+    std::vector<FMIdxRange> sense_v;
+    std::vector<FMIdxRange> antisense_v;
+    std::vector<FMIdxRange> last_match_pos_record;
+    std::vector<FMIdxRange> last_search_range;
+    std::vector<SeedMMType> seed_mismatch_record;
+    std::vector<Mismatchtype> tail_mismatch_record;
+    std::vector<int> tail_pos_record;
+    std::vector<IndexType> located;
+  };
+
+  static Arena& thread_arena()
+  {
+    thread_local Arena arena;
+    return arena;
+  }
+
 private:
   Indexer fm_index;
   Indexer rc_fm_index;
@@ -54,49 +111,83 @@ public:
   std::vector<AlignedReads> align(const Fastq& fq, const std::uint32_t& reads_count = 1) const
   {
     std::vector<AlignedReads> res;
-    if (fq.seq.size() < para_pack.min_prefix_len || !fq.n_base_info_table.empty())
-      return res;
+    auto& arena = thread_arena();
+    align(fq, arena);
 
-    auto rc_query = fq.get_antisense();
+    for (auto&& a : arena.alignments)
+    {
+      std::vector<IndexType> real_pos(
+        arena.real_pos.begin() + a.hit_begin, arena.real_pos.begin() + a.hit_end);
+      std::vector<std::string> chrs;
+      for (auto i = a.hit_begin; i < a.hit_end; ++i)
+        chrs.emplace_back(fm_index.chr_names[arena.chr_ids[i]]);
 
-    std::vector<FMIdxRange> sense_v;
-    std::vector<FMIdxRange> antisense_v;
+      res.emplace_back( AlignedReads{
+        true,
+        fq,
+        a.flag,
+        a.tail_pos,
+        a.range,
+        real_pos,
+        chrs,
+        a.range.second - a.range.first,
+        a.prefix_match_len,
+        a.has_seed_mismatch,
+        a.has_tail_mismatch,
+        a.seed_mismatch,
+        a.tail_mismatch
+      });
+      res.back().set_reads_count(reads_count);
+    }
+    return res;
+  }
+
+  // align into arena, the alignments of fq replace what arena held before
+  void align(const Fastq& fq, Arena& arena) const
+  {
+    arena.alignments.clear();
+    arena.real_pos.clear();
+    arena.chr_ids.clear();
+    if (fq.seq.size() < para_pack.min_prefix_len || !fq.n_base_info_table.empty())
+      return;
+
+    arena.sense_v.clear();
+    arena.antisense_v.clear();
     
-    auto fm_mm_idx = fm_index.sbwt_exact_match_by_base(fq.seq, 0, sense_v);
-    auto rc_fm_mm_idx = rc_fm_index.sbwt_exact_match_by_base(fq.seq, 0, antisense_v);
+    // the query of the sbwt search is the reverse complement of the read,
+    // its last bases are looked up at once
+    auto fm_mm_idx = fm_index.sbwt_lookup_exact_match_by_base(fq.seq, 0, arena.sense_v, arena.rc_query);
+    auto rc_fm_mm_idx = rc_fm_index.lookup_exact_match_by_base(arena.rc_query, 0, arena.antisense_v);
+    const auto& rc_query = arena.rc_query;
 
     auto fm_multi_align = fm_mm_idx.second.second - fm_mm_idx.second.first;
     auto rc_fm_multi_align = rc_fm_mm_idx.second.second - rc_fm_mm_idx.second.first;
     
     if ( fm_multi_align + rc_fm_multi_align > para_pack.min_multi )
     {
-      return res;
+      return;
     }
     
-    search(fq, sense_v, rc_query, fm_mm_idx, res);
-    search<IsRC>(fq, antisense_v, rc_query, rc_fm_mm_idx, res);
-    for (auto&& r : res)
-    {
-      r.set_reads_count(reads_count);
-    }
+    search(fq, arena.sense_v, rc_query, fm_mm_idx, arena);
+    search<IsRC>(fq, arena.antisense_v, rc_query, rc_fm_mm_idx, arena);
+    auto& res = arena.alignments;
     if (res.size() > 1)
     {
-      if (res.front().real_pos_.size() + res.back().real_pos_.size() > para_pack.min_multi)
+      if (res.front().hit_num + res.back().hit_num > para_pack.min_multi)
       {
         res.clear();
       }
     }
-    return res;
   }
 
 private:
   template <bool IsRC = false>
   void search (
     const Fastq& fq,
-    const std::vector<FMIdxRange>& match_pos_record,
+    std::vector<FMIdxRange>& match_pos_record,
     const SEQ& query,
     const std::pair<IndexType, FMIdxRange>& mm_idx,
-    std::vector<AlignedReads>& res
+    Arena& res
   ) const
   {
     IndexType prefix_match_len = mm_idx.first;
@@ -109,12 +200,20 @@ private:
     }
     else if (prefix_match_len < para_pack.min_prefix_len && para_pack.allow_mm)
     {
-      std::vector<SeedMMType> seed_mismatch_record;
-      std::vector<FMIdxRange> last_match_pos_record;
+      auto& seed_mismatch_record = res.seed_mismatch_record;
+      auto& last_match_pos_record = res.last_match_pos_record;
       IndexType mismatch_idx = query.size() - prefix_match_len - 1;
-      std::vector<int> tail_pos_record;
+      auto& tail_pos_record = res.tail_pos_record;
+      // the seed mismatch search walks back every matched base
+      if constexpr (IsRC)
+        rc_fm_index.fill_lookup_records(query, prefix_match_len, match_pos_record);
+      else
+        fm_index.fill_lookup_records(query, prefix_match_len, match_pos_record);
+      seed_mismatch_record.clear();
+      last_match_pos_record.clear();
+      tail_pos_record.clear();
       
-      check_seed_mismatch<IsRC>(match_pos_record, query, seed_mismatch_record, last_match_pos_record, mismatch_idx, tail_pos_record);
+      check_seed_mismatch<IsRC>(match_pos_record, query, seed_mismatch_record, last_match_pos_record, mismatch_idx, tail_pos_record, res);
       
       if (!seed_mismatch_record.empty())
       {
@@ -128,8 +227,10 @@ private:
         last_match_pos_record = { last_match_pos_record[index_of_min] };
         //*******************//
 
-        std::vector<Mismatchtype> tail_mismatch_record;
-        std::vector<FMIdxRange> last_search_range;
+        auto& tail_mismatch_record = res.tail_mismatch_record;
+        auto& last_search_range = res.last_search_range;
+        tail_mismatch_record.clear();
+        last_search_range.clear();
         auto tail_pos_tmp = tail_pos_record.front();
         check_tail_mismatch<IsRC>(query, last_match_pos_record.front(), tail_pos_tmp, tail_mismatch_record, last_search_range, tail_pos_record);
         
@@ -160,9 +261,12 @@ private:
     else
     {
       int tail_pos = query.size() - prefix_match_len - 1;
-      std::vector<int> tail_pos_record;
-      std::vector<Mismatchtype> tail_mismatch_record;
-      std::vector<FMIdxRange> last_search_range;
+      auto& tail_pos_record = res.tail_pos_record;
+      auto& tail_mismatch_record = res.tail_mismatch_record;
+      auto& last_search_range = res.last_search_range;
+      tail_pos_record.clear();
+      tail_mismatch_record.clear();
+      last_search_range.clear();
       
       if (para_pack.allow_mm)
         check_tail_mismatch<IsRC>(query, match_pos_record.back(), tail_pos, tail_mismatch_record, last_search_range, tail_pos_record);
@@ -191,6 +295,13 @@ private:
     return;
   }
 
+  /*
+   * Every other base at every position from mismatch_idx on is tried as
+   * the seed mismatch. Mismatches before the last half of the seed are
+   * taken from the ranges of the exact search. Those in the last half,
+   * the first bases of the backward search, are enumerated by
+   * forward_seed_mismatch instead.
+   */
   template <bool IsRC>
   void check_seed_mismatch (
     const std::vector<FMIdxRange>& match_record,
@@ -198,15 +309,18 @@ private:
     std::vector<SeedMMType>& seed_mismatch_record,
     std::vector<FMIdxRange>& last_match_pos_record,
     IndexType mismatch_idx,
-    std::vector<int>& tail_pos_record
+    std::vector<int>& tail_pos_record,
+    Arena& res
   ) const
   {
-    auto match_rng = match_record.rbegin();
+    IndexType forward_begin = query.size() - para_pack.min_prefix_len / 2;
     FMIdxRange rng;
-    for (auto i = mismatch_idx; i < query.size(); ++i)
+    for (auto i = mismatch_idx; i < forward_begin; ++i)
     {
       if (i == 0)
           continue;
+      // range of the bases after i
+      const auto& match_rng = match_record[query.size() - i - 1];
       char c;
       for (auto j = 0; j < ch_set.size(); ++j)
       {
@@ -217,37 +331,144 @@ private:
         // third para pass rng and return bool //
         if constexpr (IsRC)
         {
-          rng.first = rc_fm_index.lf_mapping ((*match_rng).first, c);
-          rng.second = rc_fm_index.lf_mapping ((*match_rng).second, c);   
+          rng.first = rc_fm_index.lf_mapping (match_rng.first, c);
+          rng.second = rc_fm_index.lf_mapping (match_rng.second, c);   
         }
         else
         {
-          rng.first = fm_index.lf_mapping ((*match_rng).first, c);
-          rng.second = fm_index.lf_mapping ((*match_rng).second, c);    
+          rng.first = fm_index.lf_mapping (match_rng.first, c);
+          rng.second = fm_index.lf_mapping (match_rng.second, c);    
         }
         if (rng.first >= rng.second) 
             continue;
         
-        base_search<IsRC>(query, i, rng, c, seed_mismatch_record, last_match_pos_record, tail_pos_record);
+        base_search<IsRC>(query, i, i, rng, c, seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
       }
-      ++match_rng;
     }
+
+    if (forward_begin < query.size())
+      forward_seed_mismatch<IsRC>(query, std::max(mismatch_idx, forward_begin), seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
   }
 
+  /*
+   * The other index holds the reverse complement of the genome, which is
+   * the reverse genome with complemented bases, so the two indexes form a
+   * bidirectional index. A BiRange is the range of a pattern in the index
+   * searched and the range of its reverse complement in the other index,
+   * the pattern can be extended by a base on either side.
+   */
+  struct BiRange
+  {
+    FMIdxRange range;
+    FMIdxRange rc_range;
+  };
+
+  /*
+   * Extends the pattern of bi by every base on its right, next is in the
+   * order of ch_set. Rows of the pattern are sorted by the base after it,
+   * and the row where the pattern ends the genome comes first, so the
+   * ranges in the index searched are cut from bi.range by the counts the
+   * other index gives.
+   */
+  template <bool IsRC>
+  void forward_extend(const BiRange& bi, std::array<BiRange, 4>& next) const
+  {
+    const auto& other_index = IsRC ? fm_index : rc_fm_index;
+    auto first = other_index.lf_mapping_all(bi.rc_range.first);
+    auto second = other_index.lf_mapping_all(bi.rc_range.second);
+    
+    auto row = bi.range.first;
+    if (bi.rc_range.first <= other_index.seq_end_pos && other_index.seq_end_pos < bi.rc_range.second)
+      ++row;
+    for (std::size_t j = 0; j < ch_set.size(); ++j)
+    {
+      // complement of ch_set[j]
+      auto k = ch_set.size() - 1 - j;
+      next[j].rc_range = { first[k], second[k] };
+      next[j].range = { row, row + second[k] - first[k] };
+      row = next[j].range.second;
+    }
+  }
+
+  static std::size_t base_order(char c)
+  {
+    return std::find(ch_set.cbegin(), ch_set.cend(), c) - ch_set.cbegin();
+  }
+
+  /*
+   * Seed mismatches from mismatch_begin on, all in the last half of the
+   * seed. A backward search from the read end would try each of them 
+   * with the bases after it matched only, and walk all the way to the
+   * seed start for most. The seed is matched forward from its start
+   * instead: the bases before the last half are matched once, every 
+   * extension step gives the three other bases of its position at no 
+   * cost, and a mismatch is given up as soon as the seed around it is 
+   * not in the genome. What covers the whole seed goes on with 
+   * base_search, so the records are the same as a backward search.
+   */
+  template <bool IsRC>
+  void forward_seed_mismatch (
+    const SEQ& query,
+    IndexType mismatch_begin,
+    std::vector<SeedMMType>& seed_mismatch_record,
+    std::vector<FMIdxRange>& last_match_pos_record,
+    std::vector<int>& tail_pos_record,
+    Arena& res
+  ) const
+  {
+    const auto& index = IsRC ? rc_fm_index : fm_index;
+    const auto& other_index = IsRC ? fm_index : rc_fm_index;
+    IndexType seed_begin = query.size() - para_pack.min_prefix_len;
+    
+    BiRange bi { {0, index.bwt_seq.size()}, {0, other_index.bwt_seq.size()} };
+    std::array<BiRange, 4> next, mm_next;
+    for (auto i = seed_begin; i < query.size(); ++i)
+    {
+      forward_extend<IsRC>(bi, next);
+      
+      for (auto j = 0; i >= mismatch_begin && i != 0 && j < ch_set.size(); ++j)
+      {
+        char c = ch_set[j];
+        if (query[i] == c)
+          continue;
+        
+        auto mm_bi = next[j];
+        for (auto k = i + 1; k < query.size() && mm_bi.range.first < mm_bi.range.second; ++k)
+        {
+          forward_extend<IsRC>(mm_bi, mm_next);
+          mm_bi = mm_next[base_order(query[k])];
+        }
+        if (mm_bi.range.first >= mm_bi.range.second)
+          continue;
+        
+        if (seed_begin == 0)
+          record_seed_mismatch<IsRC>(mm_bi.range, query.size(), i, c, -1, seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
+        else
+          base_search<IsRC>(query, i, seed_begin, mm_bi.range, c, seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
+      }
+
+      bi = next[base_order(query[i])];
+      if (bi.range.first >= bi.range.second)
+        return;
+    }
+  }
+
+  // goes on searching backward from search_pos - 1, start_pos is where the seed mismatch is
   template <bool IsRC>
   void base_search(
     const SEQ& query,
     std::uint32_t start_pos,
+    std::uint32_t search_pos,
     FMIdxRange& rng,
     char mismatch_char,
     std::vector<SeedMMType>& seed_mismatch_record,
     std::vector<FMIdxRange>& last_match_pos_record,
-    std::vector<int>& tail_pos_record
+    std::vector<int>& tail_pos_record,
+    Arena& res
   ) const
   {
-    auto idx = start_pos - 1;    
+    auto idx = search_pos - 1;    
     FMIdxRange previous_rng;
-    std::vector<IndexType> real_pos;
     while (1)
     {
       previous_rng = rng;
@@ -266,41 +487,56 @@ private:
       if (rng.first >= rng.second)
       {
         if (idx < query.size() - para_pack.min_prefix_len)
-        {
-          if constexpr (IsRC)
-              real_pos = rc_fm_index.sbwt_range_to_seq_idx(previous_rng, query.size() - idx - 1);
-          else
-              real_pos = fm_index.sbwt_range_to_seq_idx(previous_rng, query.size() - idx - 1);
-          
-          for (auto&& pos : real_pos)
-          {
-            seed_mismatch_record.emplace_back(std::make_tuple(pos, start_pos, mismatch_char));
-            tail_pos_record.push_back(idx);
-            last_match_pos_record.push_back(previous_rng);
-          }
-        }
+          record_seed_mismatch<IsRC>(previous_rng, query.size() - idx - 1, start_pos, mismatch_char, idx, seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
         break;
       }
 
       if (idx == 0)
       { 
-          if constexpr (IsRC)
-              real_pos = rc_fm_index.sbwt_range_to_seq_idx(rng, query.size());
-          else
-              real_pos = fm_index.sbwt_range_to_seq_idx(rng, query.size());
-
-          for (auto&& pos : real_pos)
-          {
-            seed_mismatch_record.emplace_back(std::make_tuple(pos, start_pos, mismatch_char));
-            tail_pos_record.emplace_back(-1);
-            last_match_pos_record.push_back(rng);
-          }
-
+          record_seed_mismatch<IsRC>(rng, query.size(), start_pos, mismatch_char, -1, seed_mismatch_record, last_match_pos_record, tail_pos_record, res);
           break;
       }
       --idx;
     }
   } 
+
+  template <bool IsRC>
+  void record_seed_mismatch(
+    const FMIdxRange& rng,
+    IndexType match_len,
+    std::uint32_t start_pos,
+    char mismatch_char,
+    int tail_pos,
+    std::vector<SeedMMType>& seed_mismatch_record,
+    std::vector<FMIdxRange>& last_match_pos_record,
+    std::vector<int>& tail_pos_record,
+    Arena& res
+  ) const
+  {
+    // hits of one range only differ in position, one record stands
+    // for all of them when they are not located
+    if (!res.locate)
+    {
+      seed_mismatch_record.emplace_back(std::make_tuple(0, start_pos, mismatch_char));
+      tail_pos_record.push_back(tail_pos);
+      last_match_pos_record.push_back(rng);
+      return;
+    }
+    
+    auto& real_pos = res.located;
+    real_pos.clear();
+    if constexpr (IsRC)
+        rc_fm_index.sbwt_range_to_seq_idx(rng, match_len, real_pos);
+    else
+        fm_index.sbwt_range_to_seq_idx(rng, match_len, real_pos);
+
+    for (auto&& pos : real_pos)
+    {
+      seed_mismatch_record.emplace_back(std::make_tuple(pos, start_pos, mismatch_char));
+      tail_pos_record.push_back(tail_pos);
+      last_match_pos_record.push_back(rng);
+    }
+  }
   
   template <bool IsRC>
   void check_tail_mismatch(
@@ -388,42 +624,26 @@ private:
     const Fastq& fq,
     const FMIdxRange& rng,
     int tail_pos,
-    std::vector<AlignedReads>& res,
+    Arena& res,
     const Mismatchtype& tail_mismatch = std::make_pair(-1, ' ')
   ) const
   {
-    std::uint16_t flag;
-    auto genome_len = fm_index.seg_info.back().first + fm_index.seg_info.back().second;
-    std::vector<IndexType> real_pos;
-    std::vector<std::string> chrs;
     IndexType prefix_match_len = fq.seq.size() - tail_pos - 1;
+    auto& real_pos = res.located;
+    real_pos.clear();
+    IndexType hit_num = rng.second - rng.first;
     
-    if constexpr (IsRC)
+    if (res.locate)
     {
-      flag = 0;
-      real_pos = rc_fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len);
-      if (para_pack.min_multi != 0 && real_pos.size() > para_pack.min_multi) 
-          return;
-      for (auto& i : real_pos)
-      {
-        i = genome_len - i - prefix_match_len + 1;
-        chrs.emplace_back(find_chr(i));
-      }
-    }
-    else
-    {
-      flag = 16;
-      real_pos = fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len);
-      if (para_pack.min_multi != 0 && real_pos.size() > para_pack.min_multi)
-          return;
-      for (auto& i : real_pos)
-      {
-        i += 1;
-        chrs.emplace_back(find_chr(i));
-      }
+      if constexpr (IsRC)
+        rc_fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len, real_pos);
+      else
+        fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len, real_pos);
+      hit_num = real_pos.size();
     }
-   
-    if (real_pos.empty())
+    if (para_pack.min_multi != 0 && hit_num > para_pack.min_multi) 
+        return;
+    if (hit_num == 0)
         return;
      
     bool has_tail_mismatch;
@@ -433,21 +653,17 @@ private:
     else
       has_tail_mismatch = false;
 
-    res.emplace_back( AlignedReads{
-      true,
-      fq,
-      flag,
+    record_alignment<IsRC>(
+      res,
       tail_pos,
       rng,
-      real_pos,
-      chrs,
-      rng.second - rng.first,
       prefix_match_len,
+      hit_num,
       false,
       has_tail_mismatch,
       std::make_pair(-1, ' '),
       tail_mismatch
-    });
+    );
   }
 
   template <bool IsRC = false>
@@ -455,7 +671,7 @@ private:
     const Fastq& fq,
     const FMIdxRange& rng,
     int tail_pos,
-    std::vector<AlignedReads>& res,
+    Arena& res,
     const SeedMMType& seed_mismatch,
     const Mismatchtype& tail_mismatch = std::make_pair(-1, ' ')
   ) const
@@ -466,74 +682,97 @@ private:
     else
       has_tail_mismatch = false;
     
-    std::uint16_t flag;
-    auto genome_len = fm_index.seg_info.back().first + fm_index.seg_info.back().second;
-    std::vector<IndexType> real_pos;
-    std::vector<std::string> chrs;
     IndexType prefix_match_len = fq.seq.size() - tail_pos - 1;
+    auto& real_pos = res.located;
+    real_pos.clear();
+    IndexType hit_num = 1;
     
-    if constexpr (IsRC)
+    if (has_tail_mismatch)
     {
-      flag = 0;
-      if (has_tail_mismatch)
-      {
-        real_pos = rc_fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len);
-        if (para_pack.min_multi != 0 && real_pos.size() > para_pack.min_multi) 
-          return;
-      }
-      else
+      hit_num = rng.second - rng.first;
+      if (res.locate)
       {
-        real_pos.push_back(std::get<0>(seed_mismatch));
-      }
-      
-      for (auto& i : real_pos)
-      {
-        i = genome_len - i - prefix_match_len + 1;
-        chrs.emplace_back(find_chr(i));
+        if constexpr (IsRC)
+          rc_fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len, real_pos);
+        else
+          fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len, real_pos);
+        hit_num = real_pos.size();
       }
+      if (para_pack.min_multi != 0 && hit_num > para_pack.min_multi)
+        return;
     }
-    else
+    else if (res.locate)
     {
-      flag = 16;
-      if (has_tail_mismatch)
-      {
-        real_pos = fm_index.sbwt_range_to_seq_idx(rng, prefix_match_len);
-        if (para_pack.min_multi != 0 && real_pos.size() > para_pack.min_multi)
-          return;
-      }
-      else
-      {
-        real_pos.push_back(std::get<0>(seed_mismatch));
-      }
-      
-      for (auto& i : real_pos)
-      {
-        i += 1;
-        chrs.emplace_back(find_chr(i));
-      }
+      real_pos.push_back(std::get<0>(seed_mismatch));
     }
    
-    if (real_pos.empty())
+    if (hit_num == 0)
         return;
 
-    res.emplace_back( AlignedReads{
-      true,
-      fq,
-      flag,
+    record_alignment<IsRC>(
+      res,
       tail_pos,
       rng,
-      real_pos,
-      chrs,
-      rng.second - rng.first,
       prefix_match_len,
+      hit_num,
       true,
       has_tail_mismatch,
       std::make_pair(std::get<1>(seed_mismatch), std::get<2>(seed_mismatch)),
       tail_mismatch
+    );
+  }
+
+  // turn the located hits in res.located into genome positions and append,
+  // res.located is empty when the hits are not located
+  template <bool IsRC>
+  void record_alignment (
+    Arena& res,
+    int tail_pos,
+    const FMIdxRange& rng,
+    IndexType prefix_match_len,
+    IndexType hit_num,
+    bool has_seed_mismatch,
+    bool has_tail_mismatch,
+    const Mismatchtype& seed_mismatch,
+    const Mismatchtype& tail_mismatch
+  ) const
+  {
+    std::uint16_t flag;
+    auto genome_len = fm_index.seg_info.back().first + fm_index.seg_info.back().second;
+    auto hit_begin = res.real_pos.size();
+
+    if constexpr (IsRC)
+      flag = 0;
+    else
+      flag = 16;
+
+    for (auto i : res.located)
+    {
+      if constexpr (IsRC)
+        i = genome_len - i - prefix_match_len + 1;
+      else
+        i += 1;
+      res.chr_ids.push_back(find_chr(i));
+      res.real_pos.push_back(i);
+    }
+
+    res.alignments.push_back(Alignment{
+      flag,
+      tail_pos,
+      rng,
+      prefix_match_len,
+      has_seed_mismatch,
+      has_tail_mismatch,
+      seed_mismatch,
+      tail_mismatch,
+      hit_begin,
+      res.real_pos.size(),
+      hit_num
     });
   }
 
-  auto find_chr(IndexType& real_pos) const
+  // index of the chromosome real_pos is on, real_pos becomes the offset in it
+  std::uint32_t find_chr(IndexType& real_pos) const
   {
     auto comp(
       [](const std::pair<IndexType, IndexType>& a, const IndexType& b)
@@ -542,7 +781,7 @@ private:
       });
     auto it(std::lower_bound(fm_index.seg_info.cbegin(), fm_index.seg_info.cend(), real_pos, comp));
     real_pos -= (*it).first;
-    return fm_index.chr_names[std::distance(fm_index.seg_info.cbegin(), it)];
+    return std::distance(fm_index.seg_info.cbegin(), it);
   }
 };
 }
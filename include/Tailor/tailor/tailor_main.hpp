@@ -15,7 +15,11 @@ namespace tailor {
 
 constexpr auto Interval = 9;
 constexpr auto CharTypeNum = 4;
-constexpr auto LookupStrLen = 12;
+// dense lookup table up to 14 bases, sparse above, see FMIndex
+#ifndef TAILOR_LOOKUP_STR_LEN
+#define TAILOR_LOOKUP_STR_LEN 12
+#endif
+constexpr auto LookupStrLen = TAILOR_LOOKUP_STR_LEN;
 constexpr auto PrefixLen = 256;
 constexpr auto IsSBWT = true;
 constexpr auto ASCIISize = 256;
@@ -1,10 +1,17 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <fstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <unistd.h>
 #include <boost/program_options.hpp>
 #include <EARRINGS/SE/SE_auto_detect.hpp>
+#include <EARRINGS/SE/kmer_auto_detect.hpp>
 #include <EARRINGS/PE/PE_trimmer.hpp>
 #include <EARRINGS/estimate_adapter_from_BAMS.hpp>
 #include <EARRINGS/common.hpp>
@@ -17,6 +24,45 @@ void init_smallrna(int argc, const char* argv[]);
 void init_skewer(int argc, const char* argv[]);
 void init_build(int argc, const char* argv[]);
 
+// a spooled copy of the input, removed when single mode is done with it
+struct spool_file
+{
+    std::string name;
+
+    void remove()
+    {
+        if (!name.empty())
+            std::remove(name.c_str());
+        name.clear();
+    }
+
+    ~spool_file()
+    {
+        remove();
+    }
+};
+
+// copy stdin into a new file under $TMPDIR (or /tmp), return its name
+std::string spool_stdin()
+{
+    auto tmp_dir = std::getenv("TMPDIR");
+    std::string name(tmp_dir != nullptr && *tmp_dir != '\0' ? tmp_dir : "/tmp");
+    name += "/EARRINGS_stdin_XXXXXX";
+    auto fd = mkstemp(name.data());
+    if (fd == -1)
+        throw std::runtime_error("Can't create a temporary file " + name + " for stdin\n");
+    close(fd);
+
+    std::ofstream tmp(name, std::ios_base::binary);
+    tmp << std::cin.rdbuf();
+    if (!tmp.flush())
+    {
+        std::remove(name.c_str());
+        throw std::runtime_error("Can't write stdin into the temporary file " + name + "\n");
+    }
+    return name;
+}
+
 int main(int argc, const char* argv[])
 {
     std::chrono::time_point<std::chrono::steady_clock> start, end;
@@ -63,72 +109,120 @@ int main(int argc, const char* argv[])
         char errMsg[256];
         init_single(argc, argv);
 
-        if (is_bam)
+        // skewer decompresses by running gunzip on a file, keep gz stdin in one
+        spool_file stdin_spool;
+        if (is_std_stream(ifs_name[0]) && is_gz_input)
         {
-            std::string tmp_name("/tmp/EARRINGS_bam_reads.tmp");
+            stdin_spool.name = spool_stdin();
+            ifs_name[0] = stdin_spool.name;
+        }
 
-            std::cerr << "Processing BAM file...\n";
-            auto num_records = Process_uBAMs::extract_reads_from_uBAMs(
-                                                    ifs_name[0]
-                                                  , tmp_name);
-            ifs_name[0] = tmp_name;
-            std::cerr << "Finish processing BAM file!\n";
-            // check if the number of BAM records is gt than DETECT_N_READS
-            if (num_records < DETECT_N_READS)
+        try
+        {
+            if (is_bam)
             {
-                std::cerr << "Warning: Too few BAM records: " << num_records << "\n";
+                std::string tmp_name("/tmp/EARRINGS_bam_reads.tmp");
+
+                std::cerr << "Processing BAM file...\n";
+                auto num_records = Process_uBAMs::extract_reads_from_uBAMs(
+                                                        ifs_name[0]
+                                                      , tmp_name);
+                ifs_name[0] = tmp_name;
+                std::cerr << "Finish processing BAM file!\n";
+                // detection cannot converge on fewer reads than the tails it needs
+                if (num_records < DETECT_MIN_TAILS)
+                {
+                    std::cerr << "Warning: Too few BAM records for adapter detection: " << num_records << "\n";
+                }
             }
-        }
 
-        auto adapter_info = seat_adapter_auto_detect(ifs_name[0], para.nThreads);  // auto-detect adapter 
+            // the input is opened once, detection reads its head and skewer takes the
+            // head back and trims from there on, without reading the input again
+            skewer::CFILE cf;
+            if (is_std_stream(ifs_name[0]))
+            {
+                cf.fp = stdin;
+                cf.bGz = false;
+            }
+            else
+            {
+                cf = skewer::gzopen(ifs_name[0].c_str(), "r");
+                if (cf.fp == NULL)
+                    throw std::runtime_error("Can't open input file normally\n");
+            }
+            sample_streambuf sample(cf.fp, is_fastq ? 4 : 2);
+            std::istream sample_is(&sample);
+
+            auto adapter_info = kmer_detect
+                              ? kmer_adapter_auto_detect(sample_is)
+                              : seat_adapter_auto_detect(sample_is, para.nThreads);  // auto-detect adapter 
         
-        // input, output, min_len, thread, adapter, quiet flag
-        std::vector<const char*> skewer_argv( is_sensitive ? 12 : 10 );
-        skewer_argv[0] = "skewer";  // skewer is required to install beforehead.
-        skewer_argv[1] = ifs_name[0].c_str(); // input
-        skewer_argv[2] = "-o";  // output
-        skewer_argv[3] = ofs_name[0].c_str();
-        skewer_argv[4] = "-l";  // min_len
-        skewer_argv[5] = std::to_string(min_length).c_str();
-        skewer_argv[6] = "-t";  // thread
-        skewer_argv[7] = std::to_string(thread_num).c_str();
+            // input, output, min_len, thread, adapter, quiet flag
+            auto min_len = std::to_string(min_length);
+            auto threads = std::to_string(thread_num);
+            std::vector<const char*> skewer_argv( is_sensitive ? 12 : 10 );
+            skewer_argv[0] = "skewer";  // skewer is required to install beforehead.
+            skewer_argv[1] = ifs_name[0].c_str(); // input
+            skewer_argv[2] = "-o";  // output
+            skewer_argv[3] = ofs_name[0].c_str();
+            if (is_stdout_output)
+            {
+                skewer_argv[2] = "-1";  // stdout
+                skewer_argv[3] = "--quiet";
+            }
+            skewer_argv[4] = "-l";  // min_len
+            skewer_argv[5] = min_len.c_str();
+            skewer_argv[6] = "-t";  // thread
+            skewer_argv[7] = threads.c_str();
 
-        if( is_sensitive )
-        {
-            skewer_argv[8] = "-r";  // error
-            skewer_argv[9] = "0.2";
-        }
+            if( is_sensitive )
+            {
+                skewer_argv[8] = "-r";  // error
+                skewer_argv[9] = "0.2";
+            }
+            skewer_argv[ is_sensitive ? 10 : 8 ] = "-x";
+            skewer_argv[ is_sensitive ? 11 : 9 ] = std::get<0>(adapter_info).c_str();
+            auto buffer = std::to_string(buffer_mb);
+            skewer_argv.emplace_back("-B");  // memory of the reads in flight
+            skewer_argv.emplace_back(buffer.c_str());
+            if (std::get<1>(adapter_info))
+            {
+                skewer_argv.emplace_back("-C");
+            }
 
-        int32_t iRet = para.GetOpt(skewer_argv.size() - 2, skewer_argv.data(), errMsg);
-        // copy from skewer's main program.
-        if (iRet < 0)
-        {
-            const char * program = strrchr(argv[0], '/');
-            program = (program == NULL) ? argv[0] : (program + 1);
-            if (iRet == -1)
+            int32_t iRet = para.GetOpt(skewer_argv.size(), skewer_argv.data(), errMsg);
+            // copy from skewer's main program.
+            if (iRet < 0)
             {
-                if(para.bEnquireVersion)
+                const char * program = strrchr(argv[0], '/');
+                program = (program == NULL) ? argv[0] : (program + 1);
+                if (iRet == -1)
                 {
-                    para.PrintVersion(stdout);
-                    return 0;
+                    if(para.bEnquireVersion)
+                    {
+                        para.PrintVersion(stdout);
+                        return 0;
+                    }
+                    para.PrintUsage(program, stdout);
                 }
-                para.PrintUsage(program, stdout);
-            }
-            else
-            {
-                fprintf(stderr, "%s (%s): %s\n\n", program, para.version, errMsg);
-                para.PrintSimpleUsage(program, stderr);
+                else
+                {
+                    fprintf(stderr, "%s (%s): %s\n\n", program, para.version, errMsg);
+                    para.PrintSimpleUsage(program, stderr);
+                }
+                return 1;
             }
-            return 1;
+
+            skewer::run(para, &cf, sample.head().data(), sample.head().size());
+            if (!is_std_stream(ifs_name[0]))
+                skewer::gzclose(&cf);
         }
-        skewer_argv[ is_sensitive ? 10 : 8 ] = "-x";
-        skewer_argv[ is_sensitive ? 11 : 9 ] = std::get<0>(adapter_info).c_str();
-        if (std::get<1>(adapter_info))
+        catch (...)
         {
-            skewer_argv.emplace_back("-C");
+            // nothing unwinds past an uncaught exception, remove the spool here
+            stdin_spool.remove();
+            throw;
         }
-
-        skewer::main(skewer_argv.size(), skewer_argv.data());
     }
     else if (std::string(argv[1]) == "paired")
     {
@@ -144,12 +238,12 @@ int main(int argc, const char* argv[])
                                                   , tmp_name1
                                                   , tmp_name2);
             
-            // check if the number of BAM records is gt than DETECT_N_READS
             ifs_name[0] = tmp_name1;
             ifs_name[1] = tmp_name2;
-            if (num_records < DETECT_N_READS)
+            // detection cannot converge on fewer pairs than the fragments it needs
+            if (num_records < DETECT_MIN_TAILS)
             {
-                std::cerr << "Warning: Too few BAM records: " << num_records << "\n";
+                std::cerr << "Warning: Too few BAM records for adapter detection: " << num_records << "\n";
             }
         }
         PE_trim();
@@ -169,10 +263,10 @@ int main(int argc, const char* argv[])
                                                   , tmp_name);
             ifs_name[0] = tmp_name;
             std::cerr << "Finish processing BAM file!\n";
-            // check if the number of BAM records is gt than DETECT_N_READS
-            if (num_records < DETECT_N_READS)
+            // detection cannot converge on fewer reads than the tails it needs
+            if (num_records < DETECT_MIN_TAILS)
             {
-                std::cerr << "Warning: Too few BAM records: " << num_records << "\n";
+                std::cerr << "Warning: Too few BAM records for adapter detection: " << num_records << "\n";
             }
         }
 
@@ -181,13 +275,25 @@ int main(int argc, const char* argv[])
         std::map< size_t, std::string > adapters = {};
         std::map< size_t, std::string > buffers = {};
 
+        // --detect_time is shared by the whole sweep, every seed length gets an
+        // equal part of what is left. --detect_reads applies to each of them.
+        const auto sweep_seconds = detect_max_seconds;
+        std::chrono::duration<float> detect_used(0);
         for (seed_len = min_seed_len; seed_len <= max_seed_len; ++seed_len)
         {
             char buffer[2560];
             freopen("/dev/null", "a", stdout);
             setbuf(stdout, buffer);
 
-            auto adapter_info = seat_adapter_auto_detect(ifs_name[0], para.nThreads);  // auto-detect adapter
+            if (sweep_seconds != 0)
+            {
+                // 0 would lift the limit, the last seed lengths still get one batch
+                detect_max_seconds = std::max((sweep_seconds - detect_used.count()) / (max_seed_len - seed_len + 1), 1e-3f);
+            }
+            // stdout is swallowed here, the detection report goes to stderr
+            auto detect_start = std::chrono::steady_clock::now();
+            auto adapter_info = seat_adapter_auto_detect(ifs_name[0], para.nThreads, std::cerr);  // auto-detect adapter
+            detect_used += std::chrono::steady_clock::now() - detect_start;
             std::cerr << "\nTrying seed length: " << seed_len << " with found adapter: " << std::get<0>(adapter_info).c_str() << std::endl;
 
             // input, output, min_len, thread, adapter, quiet flag
@@ -250,16 +356,9 @@ int main(int argc, const char* argv[])
             std::string tmp_name("/tmp/EARRINGS_bam_reads.tmp");
 
             std::cerr << "Processing BAM file...\n";
-            auto num_records = Process_uBAMs::extract_reads_from_uBAMs(
-                                                    ifs_name[0]
-                                                  , tmp_name);
+            Process_uBAMs::extract_reads_from_uBAMs(ifs_name[0], tmp_name);
             ifs_name[0] = tmp_name;
             std::cerr << "Finish processing BAM file!\n";
-            // check if the number of BAM records is gt than DETECT_N_READS
-            if (num_records < DETECT_N_READS)
-            {
-                std::cerr << "Warning: Too few BAM records: " << num_records << "\n";
-            }
         }
 
         // input, output, min_len, thread, adapter, quiet flag
@@ -371,10 +470,14 @@ Single-end adapter trimming.
 EARRINGS detects adapter using alignment-based method. Thus, it is necessary to 
 prebuild the index first. For downstream adapter trimming, it is conducted using 
 Skewer with adapter parameters passed by EARRINGS automatically.
+With --kmer_detect, the adapter is assembled from over-represented k-mers of the 
+reads instead, and no index is needed.
 
 > EARRINGS single -p earrings_idx -1 input1.fa
 > EARRINGS single -p earrings_idx -1 input1.fq
 > EARRINGS single -p earrings_idx -1 input1.fq.gz
+> cat input1.fq | EARRINGS single -p earrings_idx -1 - -o - | bwa mem ref.fa -
+> EARRINGS single --kmer_detect -1 input1.fq
 *********************************************************************************
     )";
     
@@ -384,12 +487,16 @@ Skewer with adapter parameters passed by EARRINGS automatically.
         opts.add_options ()
         ("index_prefix,p",
          boost::program_options::
-            value<std::string>()->required(),
-            "The index prefix for pre-built index table. (required)")
+            value<std::string>(),
+            "The index prefix for pre-built index table. (required unless --kmer_detect is set)")
         ("input1,1", 
          boost::program_options::
             value<std::string>(&ifs_name[0])->required(), 
-            "The file path of Single-End reads. (required)")
+            "The file path of Single-End reads, \"-\" reads from stdin. (required)")
+        ("kmer_detect,k",
+         boost::program_options::
+            bool_switch(&kmer_detect),
+            "Detect adapter from over-represented k-mers of the reads, no index is required.")
         ("help,h", 
             "Display help message and exit.")
         ("seed_len,d",
@@ -403,11 +510,15 @@ Skewer with adapter parameters passed by EARRINGS automatically.
         ("output,o",
          boost::program_options::
             value<std::string>(&ofs_name[0])->default_value("trimmed_se"),
-            "The file prefix of Single-End FastQ output.")
+            "The file prefix of Single-End FastQ output, \"-\" writes to stdout.")
         ("min_length,m",
          boost::program_options::
             value<size_t>()->default_value(0),
             "Skip the read if the length of the read is less than --min_length after trimming.")
+        ("buffer",
+         boost::program_options::
+            value<size_t>(&buffer_mb)->default_value(buffer_mb),
+            "Maximum memory in MB for the reads being trimmed at once, at least 1.")
         ("thread,t", 
          boost::program_options::
             value<size_t>()->default_value(1), 
@@ -430,6 +541,16 @@ Skewer with adapter parameters passed by EARRINGS automatically.
          boost::program_options::
             value<std::string>(&DEFAULT_ADAPTER1)->default_value(DEFAULT_ADAPTER1),
             "Alternative adapter if auto-detect mechanism fails.")
+        ("detect_reads",
+         boost::program_options::
+            value<size_t>(&detect_max_reads)->default_value(detect_max_reads),
+            "Maximum number of reads sampled for adapter detection, 0 means unlimited. "
+            "Detection stops earlier once the support of the adapter is stable, "
+            "and after 256 MB of input at most.")
+        ("detect_time",
+         boost::program_options::
+            value<float>(&detect_max_seconds)->default_value(detect_max_seconds),
+            "Maximum seconds spent on adapter detection, 0 means unlimited.")
         ("sensitive", 
             "By default, minimum number of kmers must exceed 10 during assembly adapters. "
             "However, if user have confidence that the dataset contains adapters, sensitive "
@@ -456,6 +577,12 @@ Skewer with adapter parameters passed by EARRINGS automatically.
             exit(0);
         }
 
+        if (is_std_stream(ofs_name[0]))
+        {
+            is_stdout_output = true;
+            redirect_log_to_stderr();
+        }
+
         if (vm.count("index_prefix"))
         {
             index_prefix = vm["index_prefix"].as<std::string>();
@@ -468,6 +595,10 @@ Skewer with adapter parameters passed by EARRINGS automatically.
                     );
             }
         }
+        else if (!kmer_detect)
+        {
+            throw std::runtime_error("--index_prefix is required unless --kmer_detect is set.");
+        }
         
         thread_num = vm["thread"].as<size_t>();
         if (thread_num > 32) thread_num = 32;
@@ -503,9 +634,10 @@ Skewer with adapter parameters passed by EARRINGS automatically.
             estimate_umi_len = true;
         }
 
+        // gzip is detected by magic bytes, the extension only matters for file type
+        is_gz_input = is_gz_file(ifs_name[0]);
         std::string fa_ext(".fa"), fasta_ext(".fasta");
         if (ifs_name[0].find(".gz") == ifs_name[0].size() - 3) {
-            is_gz_input = true;
             fa_ext.append(".gz");
             fasta_ext.append(".gz");
         }
@@ -531,13 +663,15 @@ Skewer with adapter parameters passed by EARRINGS automatically.
 
         if (is_bam || 
             ifs_name[0].find(    fa_ext ) == ifs_name[0].length() -    fa_ext.length() || 
-            ifs_name[0].find( fasta_ext ) == ifs_name[0].length() - fasta_ext.length() )
+            ifs_name[0].find( fasta_ext ) == ifs_name[0].length() - fasta_ext.length() ||
+            (is_std_stream(ifs_name[0]) && !is_gz_input && std::cin.peek() == '>') )
         {
-            ofs_name[0] += ".fasta";
             is_fastq = false;
         }
-        else
-            ofs_name[0] += ".fastq";
+        if (!is_stdout_output)
+        {
+            ofs_name[0] += is_fastq ? ".fastq" : ".fasta";
+        }
 
         std::cout << std::boolalpha;
         std::cout << "Index prefix: " << index_prefix << std::endl;
@@ -547,8 +681,11 @@ Skewer with adapter parameters passed by EARRINGS automatically.
         std::cout << "Is fastq: " << is_fastq << ", Is gz input: " << is_gz_input << ", Is bam: " << is_bam << std::endl;
         std::cout << "Seed length: " << seed_len << ", Max alignment: " << min_multi << ", No mismatch: " << no_mismatch << std::endl;
         std::cout << "Prune factor: " << prune_factor << ", Sensitive mode: " << is_sensitive << std::endl;
+        std::cout << "K-mer detection: " << kmer_detect << std::endl;
         std::cout << "Min length: " << min_length << ", UMI: " << estimate_umi_len << std::endl;
         std::cout << "Default adapter: " << DEFAULT_ADAPTER1 << std::endl;
+        std::cout << "Detection budget: " << detect_max_reads << " reads, " << detect_max_seconds << " s" << std::endl;
+        std::cout << "Trimming buffer: " << buffer_mb << " MB" << std::endl;
         std::cout << std::noboolalpha;
     }
     catch (std::exception& e) 
@@ -580,6 +717,7 @@ adapter removed FastQ/FastA format output files (dual files).
 > EARRINGS paired -1 input1.fa -2 input2.fa
 > EARRINGS paired -1 input1.fq -2 input2.fq
 > EARRINGS paired -1 input1.fq.gz -2 input2.fq.gz
+> cat interleaved.fq | EARRINGS paired -1 - -o - | bwa mem -p ref.fa -
 *******************************************************************************************
 )"; 
     
@@ -591,17 +729,25 @@ adapter removed FastQ/FastA format output files (dual files).
         ("input1,1", 
          boost::program_options::
             value<std::string>(&ifs_name[0])->required(), 
-            "The Paired-end reads input file 1.")
+            "The Paired-end reads input file 1, \"-\" reads interleaved pairs from stdin.")
         ("input2,2", 
          boost::program_options::
-            value<std::string>(&ifs_name[1])->required(), 
-            "The Paired-end reads input file 2.")
+            value<std::string>(&ifs_name[1]), 
+            "The Paired-end reads input file 2, not needed for interleaved input.")
+        ("interleaved_in,I",
+         boost::program_options::
+            bool_switch(&is_interleaved_input),
+            "Input file 1 contains both mates, mate 1 followed by mate 2.")
+        ("interleaved_out",
+         boost::program_options::
+            bool_switch(&is_interleaved_output),
+            "Write both mates into a single interleaved output file.")
         ("help,h", 
             "Display help message and exit.")
         ("output,o",
          boost::program_options::
             value<std::string>(&ofs_name[0])->default_value("trimmed_pe"),
-            "The Paired-End FastQ output file prefix.")
+            "The Paired-End FastQ output file prefix, \"-\" writes interleaved pairs to stdout.")
         ("adapter1,a",
          boost::program_options::
             value<std::string>(&DEFAULT_ADAPTER1)->default_value(DEFAULT_ADAPTER1),
@@ -610,6 +756,15 @@ adapter removed FastQ/FastA format output files (dual files).
          boost::program_options::
             value<std::string>(&DEFAULT_ADAPTER2)->default_value(DEFAULT_ADAPTER2),
             "Alternative adapter 2 if auto-detect mechanism fails.")
+        ("detect_reads",
+         boost::program_options::
+            value<size_t>(&detect_max_reads)->default_value(detect_max_reads),
+            "Maximum number of pairs sampled for adapter detection, 0 means unlimited. "
+            "Detection stops earlier once the support of the adapter is stable.")
+        ("detect_time",
+         boost::program_options::
+            value<float>(&detect_max_seconds)->default_value(detect_max_seconds),
+            "Maximum seconds spent on adapter detection, 0 means unlimited.")
         ("thread,t", 
          boost::program_options::
             value<size_t>()->default_value(1), 
@@ -656,6 +811,19 @@ adapter removed FastQ/FastA format output files (dual files).
             exit(0);
         }
 
+        if (is_std_stream(ofs_name[0]))
+        {
+            is_stdout_output = true;
+            is_interleaved_output = true;
+            redirect_log_to_stderr();
+        }
+
+        // stdin carries only one stream, so both mates must be interleaved
+        if (is_std_stream(ifs_name[0]))
+        {
+            is_interleaved_input = true;
+        }
+
         thread_num = vm["thread"].as<size_t>();
         if (thread_num > 32) thread_num = 32;
 
@@ -680,9 +848,10 @@ adapter removed FastQ/FastA format output files (dual files).
         seq_cmp_rate = (vm["ss_thres"].as<float>() > 0.0 && vm["ss_thres"].as<float>() < 1.0) ? vm["ss_thres"].as<float>() : 0.9;
         adapter_cmp_rate = (vm["as_thres"].as<float>() > 0.0 && vm["as_thres"].as<float>() < 1.0) ? vm["as_thres"].as<float>() : 0.8;
 
+        // gzip is detected by magic bytes, the extension only matters for file type
+        is_gz_input = is_gz_file(ifs_name[0]);
         std::string fa_ext(".fa"), fasta_ext(".fasta");
         if (ifs_name[0].find(".gz") == ifs_name[0].size() - 3) {
-            is_gz_input = true;
             fa_ext.append(".gz");
             fasta_ext.append(".gz");
         }
@@ -706,23 +875,38 @@ adapter removed FastQ/FastA format output files (dual files).
             exit(1);
         }
 
+        // bam carries both mates as well
+        if (!is_interleaved_input && !is_bam && ifs_name[1].empty())
+        {
+            throw std::runtime_error("--input2 is required unless the input is interleaved.");
+        }
+
         ofs_name[1] = ofs_name[0];
         if (is_bam ||
             ifs_name[0].find(    fa_ext ) == ifs_name[0].length() -    fa_ext.length() || 
-            ifs_name[0].find( fasta_ext ) == ifs_name[0].length() - fasta_ext.length() )
+            ifs_name[0].find( fasta_ext ) == ifs_name[0].length() - fasta_ext.length() ||
+            (is_std_stream(ifs_name[0]) && !is_gz_input && std::cin.peek() == '>') )
         {
-            ofs_name[0] += "_1.fasta";
-            ofs_name[1] += "_2.fasta";
             is_fastq = false;
         }
+
+        std::string out_ext(is_fastq ? ".fastq" : ".fasta");
+        if (is_stdout_output)
+            ;
+        else if (is_interleaved_output)
+        {
+            ofs_name[0] += out_ext;
+            ofs_name[1] = ofs_name[0];
+        }
         else {
-            ofs_name[0] += "_1.fastq";
-            ofs_name[1] += "_2.fastq";
+            ofs_name[0] += "_1" + out_ext;
+            ofs_name[1] += "_2" + out_ext;
         }
 
         std::cout << std::boolalpha;
         std::cout << "Index prefix: " << index_prefix << std::endl;
         std::cout << "Input file name 1: " << ifs_name[0] << ", Input file name 2:" << ifs_name[1] << std::endl;
+        std::cout << "Interleaved input: " << is_interleaved_input << ", Interleaved output: " << is_interleaved_output << std::endl;
         std::cout << "Output file name 1: " << ofs_name[0]<< ", Output file name 2:" << ofs_name[1]  << std::endl;
         std::cout << "# of threads: " << thread_num << std::endl;
         std::cout << "Is fastq: " << is_fastq << ", Is gz input: " << is_gz_input << ", Is bam: " << is_bam << std::endl;
@@ -731,6 +915,7 @@ adapter removed FastQ/FastA format output files (dual files).
         std::cout << "Match rate: " << match_rate << ", Seq cmp rate: " << seq_cmp_rate << ", Adapter cmp rate: " << adapter_cmp_rate << std::endl;
         std::cout << "Default adapter1: " << DEFAULT_ADAPTER1 << std::endl;
         std::cout << "Default adapter2: " << DEFAULT_ADAPTER2 << std::endl;
+        std::cout << "Detection budget: " << detect_max_reads << " pairs, " << detect_max_seconds << " s" << std::endl;
         std::cout << std::noboolalpha;
     }
     catch (std::exception& e) 
@@ -813,6 +998,15 @@ and using Skewer to trim the adapter from the reads (default as sensitive mode).
          boost::program_options::
             value<std::string>(&DEFAULT_ADAPTER1)->default_value(DEFAULT_ADAPTER1),
             "Alternative adapter if auto-detect mechanism fails.")
+        ("detect_reads",
+         boost::program_options::
+            value<size_t>(&detect_max_reads)->default_value(detect_max_reads),
+            "Maximum number of reads sampled for adapter detection at each seed length, 0 means unlimited. "
+            "Detection stops earlier once the support of the adapter is stable.")
+        ("detect_time",
+         boost::program_options::
+            value<float>(&detect_max_seconds)->default_value(detect_max_seconds),
+            "Maximum seconds spent on adapter detection for the whole seed length sweep, 0 means unlimited.")
         ("UMI,u", 
             "Estimate the size of UMI sequences, results will be printed to console by "
             "default.");
@@ -881,9 +1075,10 @@ and using Skewer to trim the adapter from the reads (default as sensitive mode).
             estimate_umi_len = true;
         }
 
+        // gzip is detected by magic bytes, the extension only matters for file type
+        is_gz_input = is_gz_file(ifs_name[0]);
         std::string fa_ext(".fa"), fasta_ext(".fasta");
         if (ifs_name[0].find(".gz") == ifs_name[0].size() - 3) {
-            is_gz_input = true;
             fa_ext.append(".gz");
             fasta_ext.append(".gz");
         }
@@ -927,6 +1122,7 @@ and using Skewer to trim the adapter from the reads (default as sensitive mode).
         std::cout << "Prune factor: " << prune_factor << ", Sensitive mode: " << is_sensitive << std::endl;
         std::cout << "Min length: " << min_length << ", UMI: " << estimate_umi_len << std::endl;
         std::cout << "Default adapter: " << DEFAULT_ADAPTER1 << std::endl;
+        std::cout << "Detection budget: " << detect_max_reads << " reads, " << detect_max_seconds << " s" << std::endl;
         std::cout << std::noboolalpha;
     }
     catch (std::exception& e) 
@@ -1008,9 +1204,10 @@ adapter sequence via Skewer (default as sensitive mode).
         is_sensitive = true;
         min_length = vm["min_length"].as<size_t>();
 
+        // gzip is detected by magic bytes, the extension only matters for file type
+        is_gz_input = is_gz_file(ifs_name[0]);
         std::string fa_ext(".fa"), fasta_ext(".fasta");
         if (ifs_name[0].find(".gz") == ifs_name[0].size() - 3) {
-            is_gz_input = true;
             fa_ext.append(".gz");
             fasta_ext.append(".gz");
         }
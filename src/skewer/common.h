@@ -45,7 +45,9 @@ typedef unsigned int uint;
 typedef unsigned char uchar;
 
 const int MAX_PATH = 255;
-const int MAX_ADAPTER_LEN = 64;
+const int MAX_ADAPTER_LEN = 256;
+const int MAX_ADAPTER_WORDS = MAX_ADAPTER_LEN / 64;
+const int MAX_READ_ADAPTER_LEN = 64; // reads used as adapters by Init2
 const int MAX_ADAPTER_CNT = 96;
 
 typedef struct tag_INDEX{
@@ -48,6 +48,11 @@ cFQ::cFQ()
 	offset = 0L;
 	next_pos = 0L;
 	rno = 0;
+
+	buf = (char *)malloc(BUF_SIZE);
+	bufPos = bufEnd = 0;
+	head = NULL;
+	headLen = 0;
 }
 
 cFQ::~cFQ()
@@ -60,18 +65,119 @@ cFQ::~cFQ()
 		free(rec.com.s);
 	if(rec.qual.s != NULL)
 		free(rec.qual.s);
+	free(buf);
 }
 
-void cFQ::associateFile(FILE * fp)
+void cFQ::associateFile(FILE * fp, const char * head, size_t headLen)
 {
 	in = fp;
 	offset = 0L;
 	rno = 0;
+	bufPos = bufEnd = 0;
+	this->head = head;
+	this->headLen = (head != NULL) ? headLen : 0;
+}
+
+// refill the buffer when it is used up, return the number of bytes left
+inline size_t cFQ::fill()
+{
+	if(bufPos < bufEnd)
+		return (bufEnd - bufPos);
+	bufPos = 0;
+	if(headLen > 0){
+		bufEnd = std::min(headLen, BUF_SIZE);
+		memcpy(buf, head, bufEnd);
+		head += bufEnd;
+		headLen -= bufEnd;
+	}
+	else{
+		bufEnd = (in != NULL) ? fread(buf, 1, BUF_SIZE, in) : 0;
+	}
+	return bufEnd;
+}
+
+inline int cFQ::get_char()
+{
+	return (fill() > 0) ? uchar(buf[bufPos++]) : EOF;
+}
+
+// make room for n more bytes in l
+inline void cFQ::reserve(LINE &l, size_t n)
+{
+	if(l.a <= size_t(l.n) + n){
+		l.a = (size_t(l.n) + n) * 3 / 2 + 64;
+		l.s = (char *)realloc(l.s, l.a);
+	}
 }
 
+// same as getline(): the line with its '\n', or -1 at the end of file
 inline int cFQ::read_line(LINE &l)
 {
-	return (l.n = getline(&l.s, &l.a, in));
+	char *p, *q;
+	size_t n;
+	l.n = 0;
+	while(fill() > 0){
+		p = buf + bufPos;
+		q = (char *)memchr(p, '\n', bufEnd - bufPos);
+		n = (q != NULL) ? (q - p + 1) : (bufEnd - bufPos);
+		reserve(l, n);
+		memcpy(l.s + l.n, p, n);
+		l.n += n;
+		bufPos += n;
+		if(q != NULL) break;
+	}
+	reserve(l, 0);
+	l.s[l.n] = '\0';
+	if(l.n == 0)
+		l.n = -1;
+	return l.n;
+}
+
+inline bool isSpace(char c)
+{
+	return isspace(uchar(c)) != 0;
+}
+
+// the sequence lines of a fasta record up to the next '>', whitespace removed
+inline void cFQ::read_fasta_seq(LINE &l)
+{
+	char *p, *q, *end;
+	l.n = 0;
+	while(fill() > 0){
+		p = buf + bufPos;
+		end = (char *)memchr(p, '>', bufEnd - bufPos);
+		if(end == NULL) end = buf + bufEnd;
+		bufPos = end - buf;
+		// one line at a time, the line breaks are dropped
+		for(; p < end; p = q + 1){
+			q = (char *)memchr(p, '\n', end - p);
+			if(q == NULL) q = end;
+			reserve(l, q - p);
+			l.n = std::remove_copy_if(p, q, l.s + l.n, isSpace) - l.s;
+		}
+		if(bufPos < bufEnd) break; // stopped at '>'
+	}
+	reserve(l, 0);
+	l.s[l.n] = '\0';
+}
+
+// average bytes per record in the buffered head of the input, nothing is consumed
+int cFQ::sampleRecordSize()
+{
+	size_t n = fill();
+	if(n == 0) return 0;
+	const char *p = buf + bufPos, *end = buf + bufEnd;
+	int64 nRecords = 0;
+	if(*p == '>'){
+		for(; (p = (const char *)memchr(p, '>', end - p)) != NULL; p++)
+			nRecords++;
+	}
+	else{
+		for(; (p = (const char *)memchr(p, '\n', end - p)) != NULL; p++)
+			nRecords++;
+		nRecords /= 4;
+	}
+	return (nRecords > 0) ? int(n / nRecords) : int(n);
 }
 
 // readRecord 
@@ -84,27 +190,16 @@ int cFQ::readRecord(RECORD *pRecord)
 	if(pRecord == NULL){
 		pRecord = &rec;
 	}
-	tag = fgetc(in);
-	if(tag == EOF)
+	int c = get_char();
+	if(c == EOF)
 		return -1;
+	tag = c;
 	read_line(pRecord->id);
 	if(tag == '>') {
 		pRecord->qual.n = 0;
 		// read fasta instead
-		char c = fgetc(in);
-		pRecord->seq.n = 0;
 		pRecord->com.n = 0;
-		while (c != '>' && c != EOF) {
-			if (pRecord->seq.a <= size_t(pRecord->seq.n+1)) {
-				pRecord->seq.s=(char *)realloc(pRecord->seq.s, pRecord->seq.a=(pRecord->seq.a * 3 / 2 + 64));
-			}
-			if (!isspace(c)) 
-				pRecord->seq.s[pRecord->seq.n++]=c;
-			c = fgetc(in);
-		}
-		if (c != EOF) {
-			ungetc(c, in);
-		}
+		read_fasta_seq(pRecord->seq);
 	}
 	else{
 		read_line(pRecord->seq);
@@ -146,6 +241,17 @@ const char *fext(const char *f) {
 	return (x != NULL) ? (x + 1) : "";
 }
 
+// gzip members start with the magic bytes 0x1f 0x8b, whatever the file is named
+bool isgz(const char *fileName) {
+	FILE *fp = fopen(fileName, "rb");
+	if(fp == NULL)
+		return false;
+	unsigned char magic[2];
+	bool bGz = (fread(magic, 1, 2, fp) == 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b);
+	fclose(fp);
+	return bGz;
+}
+
 ///////////////////////
 // external functions
 CFILE gzopen(const char * fileName, const char * mode)
@@ -153,14 +259,16 @@ CFILE gzopen(const char * fileName, const char * mode)
 	// maybe use zlib some day?
 	CFILE cf;
 	const char * ext = fext(fileName);
+	bool bReadGz = false;
 	if(strcmp(mode, "r") == 0){
 		cf.fp = fopen(fileName, "r");
 		if(cf.fp == NULL){
 			return cf;
 		}
 		fclose(cf.fp);
+		bReadGz = isgz(fileName);
 	}
-	if (strcmp(ext,"gz") == 0) {
+	if ( bReadGz || ((strcmp(ext,"gz") == 0) && strchr(mode, 'w')) ) {
 		char *tmp=(char *)malloc(strlen(fileName)+100);
 		if (strchr(mode, 'w')) {
 			strcpy(tmp, "gzip --rsyncable > '");
@@ -209,8 +317,7 @@ int64 gzsize(const char * fileName)
 	FILE * fp = fopen(fileName, "rb");
 	if(fp == NULL)
 		return 0L;
-	size_t len = strlen(fileName);
-	bool bCompressed = (len > 3) && (strcmp(fileName + len - 3, ".gz") == 0);
+	bool bCompressed = isgz(fileName);
 	int64 file_length = 0L;
 	if(bCompressed){
 		if(fseek(fp, -4L, SEEK_END) == 0){
@@ -270,38 +377,41 @@ int gzreadlen(char * fileName)
 	return nReadLen;
 }
 
+// format of the records read by fq, up to the first one that tells
+static enum FASTQ_FORMAT fqformat(cFQ & fq)
+{
+	int j;
+	char *str;
+	char chr;
+	while(fq.readRecord() > 0){
+		if(fq.rec.com.n == 0){
+			return FASTA;
+		}
+		for(j=0, str=fq.rec.qual.s; j<fq.rec.qual.n; j++){
+			chr = *(str++);
+			if(chr < 59){
+				return SANGER_FASTQ;
+			}
+			if(chr > 74){
+				return SOLEXA_FASTQ;
+			}
+		}
+	}
+	return UNKNOWN_FASTQ;
+}
+
 enum FASTQ_FORMAT gzformat(char * fileNames[], int nFileCnt)
 {
 	CFILE cf;
 	cFQ fq;
-	int i, j;
-	char *str;
-	char chr;
+	int i;
 
 	FASTQ_FORMAT format = UNKNOWN_FASTQ, format_new;
 	for(i=0; i<nFileCnt; i++){
 		cf = gzopen(fileNames[i], "r");
 		if(cf.fp == NULL) break;
 		fq.associateFile(cf.fp);
-		format_new = UNKNOWN_FASTQ;
-		while(fq.readRecord() > 0){
-			if(fq.rec.com.n == 0){
-				format_new = FASTA;
-				break;
-			}
-			for(j=0, str=fq.rec.qual.s; j<fq.rec.qual.n; j++){
-				chr = *(str++);
-				if(chr < 59){
-					format_new = SANGER_FASTQ;
-					break;
-				}
-				if(chr > 74){
-					format_new = SOLEXA_FASTQ;
-					break;
-				}
-			}
-			if(j < fq.rec.qual.n) break;
-		}
+		format_new = fqformat(fq);
 		gzclose(&cf);
 		if(format == UNKNOWN_FASTQ){
 			format = format_new;
@@ -317,6 +427,14 @@ enum FASTQ_FORMAT gzformat(char * fileNames[], int nFileCnt)
 	return format;
 }
 
+// format of an input whose head has been read already, only the head is looked at
+enum FASTQ_FORMAT headformat(const char * head, size_t len)
+{
+	cFQ fq;
+	fq.associateFile(NULL, head, len);
+	return fqformat(fq);
+}
+
 void gzstrncpy (char * dest, const char * src, int n)
 {
 	while( (*dest++ = *src++) && --n );
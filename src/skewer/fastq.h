@@ -44,6 +44,7 @@
 #include <sys/stat.h>
 #include <search.h>
 #include <limits.h>
+#include <algorithm>
 
 #include <time.h>
 #ifdef __MACH__
@@ -100,7 +101,18 @@ public:
 	int rno;
 
 private:
+	static const size_t BUF_SIZE = 1 << 22;
+	char * buf; // block of the input, consumed from bufPos to bufEnd
+	size_t bufPos;
+	size_t bufEnd;
+	const char * head; // bytes already taken from in by the caller, read before in
+	size_t headLen;
+
+	inline size_t fill();
+	inline int get_char();
+	inline void reserve(LINE &l, size_t n);
 	inline int read_line(LINE &l);
+	inline void read_fasta_seq(LINE &l);
 
 public:
 	cFQ();
@@ -108,8 +120,9 @@ public:
 //	bool InitBuffer(int nBuffSize=256);
 //	void DestroyBuffer();
 //	void clearBuffer();
-	void associateFile(FILE * fp);
+	void associateFile(FILE * fp, const char * head=NULL, size_t headLen=0);
 	int readRecord(RECORD *pRecord=NULL);
+	int sampleRecordSize();
 //	int readRecord2Buffer();
 //	RECORD * getLastRecord();
 	inline int64 tell(){ return offset; }
@@ -135,6 +148,7 @@ extern CFILE gzopen(const char * fileName, const char *mode);
 extern int gzclose(CFILE *f);
 extern int64 gzsize(const char * fileName);
 extern enum FASTQ_FORMAT gzformat(char * fileNames[], int nFileCnt);
+extern enum FASTQ_FORMAT headformat(const char * head, size_t len);
 extern int gzreadlen(char * fileName);
 extern void gzstrncpy (char * dest, const char * src, int n);
 
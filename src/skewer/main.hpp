@@ -47,19 +47,73 @@
 using namespace std;
 
 namespace skewer{ 
-inline void OutputTaggedRecord(FILE * fpOut, RECORD * pRecord)
+// output of one worker, records are assembled with memcpy into a buffer per
+// destination file, each buffer is written with one fwrite per block
+class cRecordWriter
+{
+	vector<FILE *> files;
+	vector<string> bufs;
+
+public:
+	string & operator[](FILE * fp){
+		size_t i;
+		for(i=0; i<files.size(); i++){
+			if(files[i] == fp) return bufs[i];
+		}
+		files.push_back(fp);
+		bufs.push_back(string());
+		bufs.back().reserve(1 << 20);
+		return bufs.back();
+	}
+	// called by the ordered writer at the end of every block
+	void flush(){
+		size_t i;
+		for(i=0; i<files.size(); i++){
+			if(bufs[i].empty()) continue;
+			fwrite(bufs[i].data(), 1, bufs[i].size(), files[i]);
+			bufs[i].clear();
+		}
+	}
+};
+
+// same as "%.*s"
+inline void AppendField(string & out, const char * s, int len)
+{
+	out.append(s, strnlen(s, len));
+}
+
+inline void OutputTaggedRecord(string & out, RECORD * pRecord)
 {
 	// refer to "enum REC_TAG" defined in "fastq.h"
 	const char * TAG_NAME[8] = { "NORMAL", "BLURRY", "BADQUAL", "EMPTY", "SHORT", "CONTAMINANT", "UNDETERMINED", "LONG" };
+	out += (pRecord->com.n > 0) ? '@' : '>';
+	out.append(pRecord->id.s, strcspn(pRecord->id.s, "\n"));
+	out += " TAG=";
+	out += TAG_NAME[pRecord->tag];
+	out += '\n';
+	out.append(pRecord->seq.s, pRecord->seq.n);
+	out += '\n';
 	if(pRecord->com.n > 0){ // fastq
-		fprintf(fpOut, "@%s TAG=%s\n%s\n+\n%s\n", strtok(pRecord->id.s, "\n"), TAG_NAME[pRecord->tag], pRecord->seq.s, pRecord->qual.s);
+		out += "+\n";
+		out.append(pRecord->qual.s, pRecord->qual.n);
+		out += '\n';
 	}
-	else{ // fasta
-		fprintf(fpOut, ">%s TAG=%s\n%s\n", strtok(pRecord->id.s, "\n"), TAG_NAME[pRecord->tag], pRecord->seq.s);
+}
+
+inline void OutputEntireRecord(string & out, RECORD * pRecord)
+{
+	out += (pRecord->com.n > 0) ? '@' : '>';
+	out.append(pRecord->id.s, pRecord->id.n);
+	out.append(pRecord->seq.s, pRecord->seq.n);
+	out += '\n';
+	if(pRecord->com.n > 0){ // fastq
+		out += "+\n";
+		out.append(pRecord->qual.s, pRecord->qual.n);
+		out += '\n';
 	}
 }
 
-inline void OutputMaskedRecord(FILE * fpOut, RECORD * pRecord, int offset, int len)
+inline void OutputMaskedRecord(string & out, RECORD * pRecord, int offset, int len)
 {
 	int i;
 	for(i=0; i<offset; i++){
@@ -68,41 +122,54 @@ inline void OutputMaskedRecord(FILE * fpOut, RECORD * pRecord, int offset, int l
 	for(i=offset+len; i<pRecord->seq.n; i++){
 		pRecord->seq.s[i] = tolower(pRecord->seq.s[i]);
 	}
-	if(pRecord->com.n > 0) // fastq
-		fprintf(fpOut, "@%s%s\n+\n%s\n", pRecord->id.s, pRecord->seq.s, pRecord->qual.s);
-	else // fasta
-		fprintf(fpOut, ">%s%s\n", pRecord->id.s, pRecord->seq.s);
+	OutputEntireRecord(out, pRecord);
 }
 
-inline void OutputEntireRecord(FILE * fpOut, RECORD * pRecord)
+inline void OutputEntireRecordFilledWithNs(string & out, RECORD * pRecord, int offset, int len)
 {
-	if(pRecord->com.n > 0) // fastq
-		fprintf(fpOut, "@%s%s\n+\n%s\n", pRecord->id.s, pRecord->seq.s, pRecord->qual.s);
-	else // fasta
-		fprintf(fpOut, ">%s%s\n", pRecord->id.s, pRecord->seq.s);
+	int len2 = pRecord->seq.n - offset - len;
+	out += (pRecord->com.n > 0) ? '@' : '>';
+	out.append(pRecord->id.s, pRecord->id.n);
+	out.append(offset, 'N');
+	AppendField(out, pRecord->seq.s + offset, len);
+	out.append(len2, 'N');
+	out += '\n';
+	if(pRecord->com.n > 0){ // fastq
+		out += "+\n";
+		out.append(offset, '!');
+		AppendField(out, pRecord->qual.s + offset, len);
+		out.append(len2, '!');
+		out += '\n';
+	}
 }
 
-inline void OutputEntireRecordFilledWithNs(FILE * fpOut, RECORD * pRecord, int offset, int len)
+inline void OutputPartialRecord(string & out, RECORD * pRecord, int offset, int len)
 {
-	int len2 = pRecord->seq.n - offset - len;
-	string s1 = string(offset, 'N');
-	string s2 = string(len2, 'N');
+	out += (pRecord->com.n > 0) ? '@' : '>';
+	out.append(pRecord->id.s, pRecord->id.n);
+	AppendField(out, pRecord->seq.s + offset, len);
+	out += '\n';
 	if(pRecord->com.n > 0){ // fastq
-		string q1 = string(offset, '!');
-		string q2 = string(len2, '!');
-		fprintf(fpOut, "@%s%s%.*s%s\n+\n%s%.*s%s\n", pRecord->id.s, s1.c_str(), len, pRecord->seq.s + offset, s2.c_str(),
-				q1.c_str(), len,  pRecord->qual.s + offset, q2.c_str());
+		out += "+\n";
+		AppendField(out, pRecord->qual.s + offset, len);
+		out += '\n';
 	}
-	else // fasta
-		fprintf(fpOut, ">%s%s%.*s%s\n", pRecord->id.s, s1.c_str(), len, pRecord->seq.s + offset, s2.c_str());
 }
 
-inline void OutputPartialRecord(FILE * fpOut, RECORD * pRecord, int offset, int len)
+// the first len bases of pRecord followed by len2 bases of pRecord2 from offset2
+inline void OutputJoinedRecord(string & out, RECORD * pRecord, int len, RECORD * pRecord2, int offset2, int len2)
 {
-	if(pRecord->com.n > 0) // fastq
-		fprintf(fpOut, "@%s%.*s\n+\n%.*s\n", pRecord->id.s, len, pRecord->seq.s + offset, len, pRecord->qual.s + offset);
-	else // fasta
-		fprintf(fpOut, ">%s%.*s\n", pRecord->id.s, len, pRecord->seq.s + offset);
+	out += (pRecord->com.n > 0) ? '@' : '>';
+	out.append(pRecord->id.s, pRecord->id.n);
+	AppendField(out, pRecord->seq.s, len);
+	AppendField(out, pRecord2->seq.s + offset2, len2);
+	out += '\n';
+	if(pRecord->com.n > 0){ // fastq
+		out += "+\n";
+		AppendField(out, pRecord->qual.s, len);
+		AppendField(out, pRecord2->qual.s + offset2, len2);
+		out += '\n';
+	}
 }
 
 class cStats
@@ -746,6 +813,7 @@ friend class cData;
 	//bool bFivePrimeEnd;
 
 	mtaux_t *mt; // for multi-threading
+	static const int BLOCK_BYTES = 1 << 20; // input bytes per block
 
 private:
 	inline bool fldEqual(char *a, char *b)
@@ -806,7 +874,7 @@ public:
 		pBuffer = NULL;
 		size = 0;
 	}
-	bool Init(cParameter * pParameter, cStats * pStats, int64 total_file_length, FILE * fp, FILE * fp2=NULL){
+	bool Init(cParameter * pParameter, cStats * pStats, int64 total_file_length, FILE * fp, FILE * fp2=NULL, const char * head=NULL, size_t headLen=0){
 		mt = (mtaux_t *)calloc(1, sizeof(mtaux_t));
 		if(mt == NULL)
 			return false;
@@ -816,11 +884,19 @@ public:
 		if( (mt->tid == NULL) || (mt->w == NULL) )
 			return false;
 		bool bPaired = (fp2 != NULL);
-		fq.associateFile(fp);
+		fq.associateFile(fp, head, headLen);
 		if(bPaired)	fq2.associateFile(fp2);
-		int nBasicSize = (total_file_length > 8 * 100 * 1024L * 1024L) ? 10 : ((total_file_length / 100 / 1024 / 1024) + 2);
-		int nBlockSize = nBasicSize * mt->n_threads;
-		int nSize = (mt->n_threads * 2 - 1) * nBlockSize; // 1, 3, 5, 7, ..., 31
+		// blocks of about BLOCK_BYTES of input, sized from the head of the input since the
+		// file length is unknown for stdin and compressed files; a record takes about 1.5
+		// times its bytes in the buffer, the blocks in flight are kept under -B
+		int64 nRecBytes = fq.sampleRecordSize() + (bPaired ? fq2.sampleRecordSize() : 0);
+		int64 nRecMem = nRecBytes * 3 / 2 + (1 + bPaired) * (sizeof(RECORD) + 4 * 64);
+		int64 nMaxRecords = int64(pParameter->nBufferMB) * 1024 * 1024 / nRecMem;
+		int nBlocks = mt->n_threads * 2 - 1; // 1, 3, 5, 7, ..., 63
+		int64 nBlockSize = (nRecBytes > 0) ? (BLOCK_BYTES / nRecBytes) : 1;
+		if(nBlockSize * nBlocks > nMaxRecords) nBlockSize = nMaxRecords / nBlocks;
+		if(nBlockSize < 1) nBlockSize = 1;
+		int nSize = nBlocks * nBlockSize;
 		if(!InitBuffer(nSize, bPaired))
 			return false;
 
@@ -863,7 +939,7 @@ public:
 				}
 			}
 		}
-		taskManager.initialize(nSize, nBlockSize);
+		taskManager.initialize(nSize, int(nBlockSize));
 		return true;
 	}
 	mtaux_t * getMultiThreadingPointer(){
@@ -878,6 +954,7 @@ void * mt_worker(void * data)
 	cStats * pStats = pData->pStats;
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpMask = pStats->fpMask;
 	FILE *fpExcl = pStats->fpExcl;
@@ -893,6 +970,12 @@ void * mt_worker(void * data)
 	TASK task;
 	int size, rc, nItemCnt, nCnt;
 	int64 startId;
+	// normal records of a block, aligned together by findAdapterBatch
+	vector<RECORD *> batchRecords;
+	vector<char *> batchSeqs;
+	vector<uchar *> batchQuals;
+	vector<size_t> batchLens, batchQLens;
+	vector<INDEX> batchIndices;
 
 	pBuffer = pData->pBuffer;
 	size = pData->size;
@@ -944,6 +1027,11 @@ void * mt_worker(void * data)
 			pTaskMan->addTask(task); // save next task for parallelism
 
 			// process the records
+			batchRecords.clear();
+			batchSeqs.clear();
+			batchQuals.clear();
+			batchLens.clear();
+			batchQLens.clear();
 			for(pRecord=&pBuffer[startId % size], nCnt=0; nCnt < nItemCnt; nCnt++, pRecord++){
 				if( pStats->bFilterNs && cMatrix::isBlurry(pRecord->seq.s, pRecord->seq.n)){
 					pRecord->tag = TAG_BLURRY;
@@ -954,7 +1042,17 @@ void * mt_worker(void * data)
 					continue;
 				}
 				pRecord->tag = TAG_NORMAL;
-				pRecord->idx = cMatrix::findAdapter(pRecord->seq.s, pRecord->seq.n, (uchar *)pRecord->qual.s, pRecord->qual.n);
+				batchRecords.push_back(pRecord);
+				batchSeqs.push_back(pRecord->seq.s);
+				batchQuals.push_back((uchar *)pRecord->qual.s);
+				batchLens.push_back(pRecord->seq.n);
+				batchQLens.push_back(pRecord->qual.n);
+			}
+			batchIndices.resize(batchRecords.size());
+			cMatrix::findAdapterBatch(batchSeqs.data(), batchLens.data(), batchQuals.data(), batchQLens.data(), int(batchRecords.size()), batchIndices.data());
+			for(nCnt=0; nCnt < int(batchRecords.size()); nCnt++){
+				pRecord = batchRecords[nCnt];
+				pRecord->idx = batchIndices[nCnt];
 				if(pRecord->idx.pos < 0){
 					pRecord->idx.pos = 0;
 				}
@@ -985,14 +1083,14 @@ void * mt_worker(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
@@ -1008,7 +1106,7 @@ void * mt_worker(void * data)
 						pRecord->tag = TAG_SHORT;
 					}
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
@@ -1017,7 +1115,7 @@ void * mt_worker(void * data)
 						pStats->nLong++;
 						pRecord->tag = TAG_LONG;
 						if(fpExcl != NULL) {
-							OutputTaggedRecord(fpExcl, pRecord);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
 						}
 						continue;
 					}
@@ -1036,24 +1134,24 @@ void * mt_worker(void * data)
 				}
 				if(bFivePrimeEnd){
 					if( (fpMask != NULL) && (pos < pRecord->seq.n) ){
-						OutputMaskedRecord(fpMask, pRecord, pRecord->seq.n - pos, pos);
+						OutputMaskedRecord(writer[fpMask], pRecord, pRecord->seq.n - pos, pos);
 					}
 					if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, pRecord->seq.n - pos, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, pRecord->seq.n - pos, pos);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, pRecord->seq.n - pos, pos);
+						OutputPartialRecord(writer[fpOut], pRecord, pRecord->seq.n - pos, pos);
 					}
 				}
 				else{
 					if( (fpMask != NULL) && (pos < pRecord->seq.n) ){
-						OutputMaskedRecord(fpMask, pRecord, 0, pos);
+						OutputMaskedRecord(writer[fpMask], pRecord, 0, pos);
 					}
 					if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, 0, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, 0, pos);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, 0, pos);
+						OutputPartialRecord(writer[fpOut], pRecord, 0, pos);
 					}
 				}
 				if(bBarcode){
@@ -1070,6 +1168,7 @@ void * mt_worker(void * data)
 				}
 				pStats->incrementCount(size_t(pos));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[startId % size];
@@ -1086,6 +1185,7 @@ void * mt_worker_ap(void * data)
 	cStats * pStats = pData->pStats;
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpMask = pStats->fpMask;
 	FILE *fpExcl = pStats->fpExcl;
@@ -1215,14 +1315,14 @@ void * mt_worker_ap(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
@@ -1238,7 +1338,7 @@ void * mt_worker_ap(void * data)
 						pRecord->tag = TAG_SHORT;
 					}
 					if(fpExcl != NULL) {
-						OutputTaggedRecord(fpExcl, pRecord);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
 					}
 					continue;
 				}
@@ -1247,7 +1347,7 @@ void * mt_worker_ap(void * data)
 						pStats->nLong++;
 						pRecord->tag = TAG_LONG;
 						if(fpExcl != NULL) {
-							OutputTaggedRecord(fpExcl, pRecord);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
 						}
 						continue;
 					}
@@ -1261,19 +1361,19 @@ void * mt_worker_ap(void * data)
 						fpOut = pStats->fpOuts[pRecord->idx.bc].fp;
 						pStats->incrementBarcode(pRecord->idx.bc);
 					}
-					OutputEntireRecord(fpOut, pRecord);
+					OutputEntireRecord(writer[fpOut], pRecord);
 				}
 				else{
 					int iCut = (pRecord->bExchange ? iCutR : iCutF);
 					if(fpMask != NULL){
 						if(pos < pRecord->seq.n - iCut)
-							OutputMaskedRecord(fpMask, pRecord, iCut, pos);
+							OutputMaskedRecord(writer[fpMask], pRecord, iCut, pos);
 					}
 					if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, iCut, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, iCut, pos);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, iCut, pos);
+						OutputPartialRecord(writer[fpOut], pRecord, iCut, pos);
 					}
 				}
 				
@@ -1285,6 +1385,7 @@ void * mt_worker_ap(void * data)
 				}
 				pStats->incrementCount(size_t(pos));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[startId % size];
@@ -1302,6 +1403,7 @@ void * mt_worker2(void * data)
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
 	cFQ * pfq2 = pStats->pfq2;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpOut2 = pStats->fpOut2;
 	FILE *fpMask = pStats->fpMask;
@@ -1444,16 +1546,16 @@ void * mt_worker2(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1476,8 +1578,8 @@ void * mt_worker2(void * data)
 						pRecord->tag = pRecord2->tag = TAG_SHORT;
 					}
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1486,8 +1588,8 @@ void * mt_worker2(void * data)
 						pStats->nLong++;
 						pRecord->tag = pRecord2->tag = TAG_LONG;
 						if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-							OutputTaggedRecord(fpExcl, pRecord);
-							OutputTaggedRecord(fpExcl2, pRecord2);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
+							OutputTaggedRecord(writer[fpExcl2], pRecord2);
 						}
 						continue;
 					}
@@ -1508,17 +1610,17 @@ void * mt_worker2(void * data)
 				}
 				if( (fpMask != NULL) && (fpMask2 != NULL) ){
 					if( (pos < pRecord->seq.n) || (pos2 < pRecord2->seq.n) ){
-						OutputMaskedRecord(fpMask, pRecord, 0, pos);
-						OutputMaskedRecord(fpMask2, pRecord2, 0, pos2);
+						OutputMaskedRecord(writer[fpMask], pRecord, 0, pos);
+						OutputMaskedRecord(writer[fpMask2], pRecord2, 0, pos2);
 					}
 				}
 				if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-					OutputEntireRecordFilledWithNs(fpOut, pRecord, 0, pos);
-					OutputEntireRecordFilledWithNs(fpOut2, pRecord2, 0, pos2);
+					OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, 0, pos);
+					OutputEntireRecordFilledWithNs(writer[fpOut2], pRecord2, 0, pos2);
 				}
 				else{
-					OutputPartialRecord(fpOut, pRecord, 0, pos);
-					OutputPartialRecord(fpOut2, pRecord2, 0, pos2);
+					OutputPartialRecord(writer[fpOut], pRecord, 0, pos);
+					OutputPartialRecord(writer[fpOut2], pRecord2, 0, pos2);
 				}
 				if(bBarcode){
 					if(pRecord->idx.bc < 0){ // assigned
@@ -1537,6 +1639,7 @@ void * mt_worker2(void * data)
 				mLen = (pos + pos2) / 2;
 				pStats->incrementCount(size_t(mLen));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[(startId << 1) % size2];
@@ -1554,6 +1657,7 @@ void * mt_worker2_sep(void * data)
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
 	cFQ * pfq2 = pStats->pfq2;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpOut2 = pStats->fpOut2;
 	FILE *fpMask = pStats->fpMask;
@@ -1682,16 +1786,16 @@ void * mt_worker2_sep(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1714,8 +1818,8 @@ void * mt_worker2_sep(void * data)
 						pRecord->tag = pRecord2->tag = TAG_SHORT;
 					}
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1724,8 +1828,8 @@ void * mt_worker2_sep(void * data)
 						pStats->nLong++;
 						pRecord->tag = pRecord2->tag = TAG_LONG;
 						if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-							OutputTaggedRecord(fpExcl, pRecord);
-							OutputTaggedRecord(fpExcl2, pRecord2);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
+							OutputTaggedRecord(writer[fpExcl2], pRecord2);
 						}
 						continue;
 					}
@@ -1747,33 +1851,33 @@ void * mt_worker2_sep(void * data)
 				if(bFivePrimeEnd){
 					if( (fpMask != NULL) && (fpMask2 != NULL) ){
 						if( (pos < pRecord->seq.n) || (pos2 < pRecord2->seq.n) ){
-							OutputMaskedRecord(fpMask, pRecord, pRecord->seq.n - pos, pos);
-							OutputMaskedRecord(fpMask2, pRecord2, pRecord2->seq.n - pos2, pos2);
+							OutputMaskedRecord(writer[fpMask], pRecord, pRecord->seq.n - pos, pos);
+							OutputMaskedRecord(writer[fpMask2], pRecord2, pRecord2->seq.n - pos2, pos2);
 						}
 					}
 					if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, pRecord->seq.n - pos, pos);
-						OutputEntireRecordFilledWithNs(fpOut2, pRecord2, pRecord2->seq.n - pos2, pos2);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, pRecord->seq.n - pos, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut2], pRecord2, pRecord2->seq.n - pos2, pos2);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, pRecord->seq.n - pos, pos);
-						OutputPartialRecord(fpOut2, pRecord2, pRecord2->seq.n - pos2, pos2);
+						OutputPartialRecord(writer[fpOut], pRecord, pRecord->seq.n - pos, pos);
+						OutputPartialRecord(writer[fpOut2], pRecord2, pRecord2->seq.n - pos2, pos2);
 					}
 				}
 				else{
 					if( (fpMask != NULL) && (fpMask2 != NULL) ){
 						if( (pos < pRecord->seq.n) || (pos2 < pRecord2->seq.n) ){
-							OutputMaskedRecord(fpMask, pRecord, 0, pos);
-							OutputMaskedRecord(fpMask2, pRecord2, 0, pos2);
+							OutputMaskedRecord(writer[fpMask], pRecord, 0, pos);
+							OutputMaskedRecord(writer[fpMask2], pRecord2, 0, pos2);
 						}
 					}
 					if(pStats->bFillWithNs){ // for equal-read-length requirement of some applications
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, 0, pos);
-						OutputEntireRecordFilledWithNs(fpOut2, pRecord2, 0, pos2);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, 0, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut2], pRecord2, 0, pos2);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, 0, pos);
-						OutputPartialRecord(fpOut2, pRecord2, 0, pos2);
+						OutputPartialRecord(writer[fpOut], pRecord, 0, pos);
+						OutputPartialRecord(writer[fpOut2], pRecord2, 0, pos2);
 					}
 				}
 				if(bBarcode){
@@ -1793,6 +1897,7 @@ void * mt_worker2_sep(void * data)
 				mLen = (pos + pos2) / 2;
 				pStats->incrementCount(size_t(mLen));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[(startId << 1) % size2];
@@ -1810,6 +1915,7 @@ void * mt_worker2_ap(void * data)
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
 	cFQ * pfq2 = pStats->pfq2;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpOut2 = pStats->fpOut2;
 	FILE *fpMask = pStats->fpMask;
@@ -1959,16 +2065,16 @@ void * mt_worker2_ap(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1985,8 +2091,8 @@ void * mt_worker2_ap(void * data)
 						pRecord->tag = pRecord2->tag = TAG_SHORT;
 					}
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -1995,8 +2101,8 @@ void * mt_worker2_ap(void * data)
 						pStats->nLong++;
 						pRecord->tag = pRecord2->tag = TAG_LONG;
 						if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-							OutputTaggedRecord(fpExcl, pRecord);
-							OutputTaggedRecord(fpExcl2, pRecord2);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
+							OutputTaggedRecord(writer[fpExcl2], pRecord2);
 						}
 						continue;
 					}
@@ -2020,43 +2126,52 @@ void * mt_worker2_ap(void * data)
 						}
 						pStats->incrementBarcode(pRecord->idx.bc);
 					}
-					OutputEntireRecord(fpOut, pRecord);
-					OutputEntireRecord(fpOut2, pRecord2);
+					OutputEntireRecord(writer[fpOut], pRecord);
+					OutputEntireRecord(writer[fpOut2], pRecord2);
 				}
 				else{
 					int iCut = (pRecord->bExchange ? iCutR : iCutF);
 					int iCut2 = (pRecord->bExchange ? iCutF : iCutR);
 					if( (fpMask != NULL) && (fpMask2 != NULL) ){
 						if( (pos < pRecord->seq.n - iCut) || (pos2 < pRecord2->seq.n - iCut2) ){
-							OutputMaskedRecord(fpMask, pRecord, iCut, pos);
-							OutputMaskedRecord(fpMask2, pRecord2, iCut2, pos2);
+							OutputMaskedRecord(writer[fpMask], pRecord, iCut, pos);
+							OutputMaskedRecord(writer[fpMask2], pRecord2, iCut2, pos2);
 						}
 					}
 					if(pStats->bFillWithNs){
-						OutputEntireRecordFilledWithNs(fpOut, pRecord, iCut, pos);
-						OutputEntireRecordFilledWithNs(fpOut2, pRecord2, iCut2, pos2);
+						OutputEntireRecordFilledWithNs(writer[fpOut], pRecord, iCut, pos);
+						OutputEntireRecordFilledWithNs(writer[fpOut2], pRecord2, iCut2, pos2);
 					}
 					else{
-						OutputPartialRecord(fpOut, pRecord, iCut, pos);
-						OutputPartialRecord(fpOut2, pRecord2, iCut2, pos2);
+						OutputPartialRecord(writer[fpOut], pRecord, iCut, pos);
+						OutputPartialRecord(writer[fpOut2], pRecord2, iCut2, pos2);
 					}
 				}
 				if( (fpBarcode != NULL) && (pRecord->idx.bc >= 0) ){
 					if( (pRecord->com.n > 0) && (pRecord2->com.n > 0) ){ // fastq
 						if(cMatrix::PrepareBarcode(barcodeSeq, pRecord->idx.bc, pRecord->seq.s, iCutF, pRecord2->seq.s, iCutR, barcodeQua, pRecord->qual.s, pRecord2->qual.s)){
-							fprintf(fpBarcode, "@%s%s\n+\n%s\n", pRecord->id.s, barcodeSeq, barcodeQua);
+							string & out = writer[fpBarcode];
+							out += '@';
+							out.append(pRecord->id.s, pRecord->id.n);
+							out += barcodeSeq;
+							out += "\n+\n";
+							out += barcodeQua;
+							out += '\n';
 						}
 						else{
-							fprintf(fpBarcode, "@%s%.*s%.*s\n+\n%.*s%.*s\n", pRecord->id.s, iCutF, pRecord->seq.s, iCutR, pRecord2->seq.s,
-										iCutF, pRecord->qual.s, iCutR, pRecord2->qual.s);
+							OutputJoinedRecord(writer[fpBarcode], pRecord, iCutF, pRecord2, 0, iCutR);
 						}
 					}
 					else{ // fasta
 						if(cMatrix::PrepareBarcode(barcodeSeq, pRecord->idx.bc, pRecord->seq.s, iCutF, pRecord2->seq.s, iCutR)){
-							fprintf(fpBarcode, ">%s%s\n", pRecord->id.s, barcodeSeq);
+							string & out = writer[fpBarcode];
+							out += '>';
+							out.append(pRecord->id.s, pRecord->id.n);
+							out += barcodeSeq;
+							out += '\n';
 						}
 						else{
-							fprintf(fpBarcode, ">%s%.*s%.*s\n", pRecord->id.s, iCutF, pRecord->seq.s, iCutR, pRecord2->seq.s);
+							OutputJoinedRecord(writer[fpBarcode], pRecord, iCutF, pRecord2, 0, iCutR);
 						}
 					}
 				}
@@ -2069,6 +2184,7 @@ void * mt_worker2_ap(void * data)
 				mLen = (pos + pos2) / 2;
 				pStats->incrementCount(size_t(mLen));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[(startId << 1) % size2];
@@ -2086,6 +2202,7 @@ void * mt_worker2_mp(void * data)
 	int64 file_length = pStats->total_file_length;
 	cFQ * pfq = pStats->pfq;
 	cFQ * pfq2 = pStats->pfq2;
+	cRecordWriter writer;
 	FILE *fpOut = pStats->fpOut;
 	FILE *fpOut2 = pStats->fpOut2;
 	FILE *fpMask = pStats->fpMask;
@@ -2310,32 +2427,32 @@ void * mt_worker2_mp(void * data)
 				if(pRecord->tag == TAG_BLURRY){
 					pStats->nBlurry++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_BADQUAL){
 					pStats->nBad++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_CONTAMINANT){
 					pStats->nContaminant++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
 				if(pRecord->tag == TAG_UNDETERMINED){
 					pStats->nUndetermined++;
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -2352,8 +2469,8 @@ void * mt_worker2_mp(void * data)
 						pRecord->tag = pRecord2->tag = TAG_SHORT;
 					}
 					if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-						OutputTaggedRecord(fpExcl, pRecord);
-						OutputTaggedRecord(fpExcl2, pRecord2);
+						OutputTaggedRecord(writer[fpExcl], pRecord);
+						OutputTaggedRecord(writer[fpExcl2], pRecord2);
 					}
 					continue;
 				}
@@ -2362,8 +2479,8 @@ void * mt_worker2_mp(void * data)
 						pStats->nLong++;
 						pRecord->tag = pRecord2->tag = TAG_LONG;
 						if( (fpExcl != NULL) && (fpExcl2 != NULL) ){
-							OutputTaggedRecord(fpExcl, pRecord);
-							OutputTaggedRecord(fpExcl2, pRecord2);
+							OutputTaggedRecord(writer[fpExcl], pRecord);
+							OutputTaggedRecord(writer[fpExcl2], pRecord2);
 						}
 						continue;
 					}
@@ -2384,38 +2501,20 @@ void * mt_worker2_mp(void * data)
 				}
 				rLen = pRecord->seq.n;
 				if( (fpMask != NULL) && (fpMask2 != NULL) ){
-					OutputMaskedRecord(fpMask, pRecord, 0, pos);
-					OutputMaskedRecord(fpMask2, pRecord2, 0, pos2);
+					OutputMaskedRecord(writer[fpMask], pRecord, 0, pos);
+					OutputMaskedRecord(writer[fpMask2], pRecord2, 0, pos2);
 				}
-				if(pRecord->com.n > 0){ // fastq
-					if(pos <= rLen){
-						fprintf(fpOut, "@%s%.*s\n+\n%.*s\n", pRecord->id.s, pos, pRecord->seq.s, pos, pRecord->qual.s);
-					}
-					else{
-						fprintf(fpOut, "@%s%.*s%.*s\n", pRecord->id.s, rLen, pRecord->seq.s, pos - rLen, pRecord2->seq.s + pos2);
-						fprintf(fpOut, "+\n%.*s%.*s\n", rLen, pRecord->qual.s, pos - rLen, pRecord2->qual.s + pos2);
-					}
-					if(pos2 <= rLen){
-						fprintf(fpOut2, "@%s%.*s\n+\n%.*s\n", pRecord2->id.s, pos2, pRecord2->seq.s, pos2, pRecord2->qual.s);
-					}
-					else{
-						fprintf(fpOut2, "@%s%.*s%.*s\n", pRecord2->id.s, rLen, pRecord2->seq.s, pos2 - rLen, pRecord->seq.s + pos);
-						fprintf(fpOut2, "+\n%.*s%.*s\n", rLen, pRecord2->qual.s, pos2 - rLen, pRecord->qual.s + pos);
-					}
+				if(pos <= rLen){
+					OutputPartialRecord(writer[fpOut], pRecord, 0, pos);
 				}
-				else{ // fasta
-					if(pos <= rLen){
-						fprintf(fpOut, ">%s%.*s\n", pRecord->id.s, pos, pRecord->seq.s);
-					}
-					else{
-						fprintf(fpOut, ">%s%.*s%.*s\n", pRecord->id.s, rLen, pRecord->seq.s, pos - rLen, pRecord2->seq.s + pos2);
-					}
-					if(pos2 <= rLen){
-						fprintf(fpOut2, ">%s%.*s\n", pRecord2->id.s, pos2, pRecord2->seq.s);
-					}
-					else{
-						fprintf(fpOut2, ">%s%.*s%.*s\n", pRecord2->id.s, rLen, pRecord2->seq.s, pos2 - rLen, pRecord->seq.s + pos);
-					}
+				else{
+					OutputJoinedRecord(writer[fpOut], pRecord, rLen, pRecord2, pos2, pos - rLen);
+				}
+				if(pos2 <= rLen){
+					OutputPartialRecord(writer[fpOut2], pRecord2, 0, pos2);
+				}
+				else{
+					OutputJoinedRecord(writer[fpOut2], pRecord2, rLen, pRecord, pos, pos2 - rLen);
 				}
 				if(bBarcode){
 					if(pRecord->idx.bc < 0){ // assigned
@@ -2433,6 +2532,7 @@ void * mt_worker2_mp(void * data)
 				}
 				pStats->incrementCount(size_t((pos + pos2) / 2));
 			}
+			writer.flush();
 			pTaskMan->decreaseCnt();
 			startId += task.nBlockSize;
 			pRecord = &pBuffer[(startId << 1) % size2];
@@ -2442,13 +2542,17 @@ void * mt_worker2_mp(void * data)
 	return NULL;
 }
 
-int processFile(cParameter * pParameter, cStats * pStats)
+int processFile(cParameter * pParameter, cStats * pStats, CFILE * pInput=NULL, const char * head=NULL, size_t headLen=0)
 {
 	CFILE cf;
 	int i;
 
 	int64 file_length;
-	if(pParameter->bStdin){
+	if(pInput != NULL){
+		cf = *pInput;
+		file_length = pParameter->bStdin ? -1 : gzsize(pParameter->input[0]);
+	}
+	else if(pParameter->bStdin){
 		cf.fp = stdin;
 		file_length = -1;
 	}
@@ -2461,10 +2565,11 @@ int processFile(cParameter * pParameter, cStats * pStats)
 			return 1;
 		}
 	}
+	bool bClose = (pInput == NULL) && !pParameter->bStdin;
 	cWork wk;
-	if(!wk.Init(pParameter, pStats, file_length, cf.fp)){
+	if(!wk.Init(pParameter, pStats, file_length, cf.fp, NULL, head, headLen)){
 		fprintf(stderr, "Can not allocate memory for workset\n");
-		gzclose(&cf);
+		if(bClose) gzclose(&cf);
 		return 1;
 	}
 	mtaux_t *mt = wk.getMultiThreadingPointer();
@@ -2494,7 +2599,7 @@ int processFile(cParameter * pParameter, cStats * pStats)
 	for(i=1; i<mt->n_threads; ++i){ // waits for termination of other threads
 		rc = pthread_join(mt->tid[i], &status);
 	}
-	if(!pParameter->bStdin){
+	if(bClose){
 		gzclose(&cf);
 	}
 	return 0;
@@ -2582,31 +2687,15 @@ int processPairedFiles(cParameter * pParameter, cStats * pStats)
 	return 0;
 }
 
-int main(int argc, const char * argv[])
+// trim with options parsed already; a single-end input the caller has opened and started
+// to read is passed as pInput, the bytes taken from it so far as head, and is neither
+// reopened nor closed
+int run(cParameter & para, CFILE * pInput=NULL, const char * head=NULL, size_t headLen=0)
 {
-	cParameter para;
 	cStats stats;
-	char errMsg[256];
-	// process the input parameters
-	int iRet = para.GetOpt(argc, argv, errMsg);
-	if(iRet < 0){
-		const char * program = strrchr(argv[0], '/');
-		program = (program == NULL) ? argv[0] : (program + 1);
-		if(iRet == -1){
-			if(para.bEnquireVersion){
-				para.PrintVersion(stdout);
-				return 0;
-			}
-			para.PrintUsage(program, stdout);
-		}
-		else{
-			fprintf(stderr, "%s (%s): %s\n\n", program, para.version, errMsg);
-			para.PrintSimpleUsage(program, stderr);
-		}
-		return 1;
-	}
+	int iRet;
 	if(para.IsAutoFastqFormat()){
-		para.fastqFormat = gzformat(para.input, para.nFileCnt);
+		para.fastqFormat = (pInput != NULL) ? headformat(head, headLen) : gzformat(para.input, para.nFileCnt);
 		if(para.fastqFormat == CONTRADICT_FASTQ){
 			fprintf(stderr, "Error: the FASTQ quality formats of input files are different\n");
 			return 1;
@@ -2657,7 +2746,7 @@ int main(int argc, const char * argv[])
 
 	////////////// process the input file(s)
 	if(para.nFileCnt <= 1){
-		iRet = processFile(&para, &stats);
+		iRet = processFile(&para, &stats, pInput, head, headLen);
 	}
 	else{
 		iRet = processPairedFiles(&para, &stats);
@@ -2687,4 +2776,29 @@ int main(int argc, const char * argv[])
 
 	return 0;
 }
+
+int main(int argc, const char * argv[])
+{
+	cParameter para;
+	char errMsg[256];
+	// process the input parameters
+	int iRet = para.GetOpt(argc, argv, errMsg);
+	if(iRet < 0){
+		const char * program = strrchr(argv[0], '/');
+		program = (program == NULL) ? argv[0] : (program + 1);
+		if(iRet == -1){
+			if(para.bEnquireVersion){
+				para.PrintVersion(stdout);
+				return 0;
+			}
+			para.PrintUsage(program, stdout);
+		}
+		else{
+			fprintf(stderr, "%s (%s): %s\n\n", program, para.version, errMsg);
+			para.PrintSimpleUsage(program, stderr);
+		}
+		return 1;
+	}
+	return run(para);
+}
 }
@@ -32,6 +32,9 @@
 #include <float.h>
 #include <algorithm>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "matrix.h"
 #include "fastq.h"
 
@@ -135,6 +138,46 @@ uint64 chrVadp[CD_CNT][CD_CNT] = {
 	{    1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   0}  //N
 };
 
+// character[complement[codeMap[c]]] for every byte c
+static struct cRevCompTable
+{
+	char chr[256];
+	cRevCompTable(){
+		for(int c=0; c<256; c++)
+			chr[c] = character[complement[codeMap[c]]];
+	}
+} revComp;
+
+#ifdef __SSE2__
+// reverse the 16 bytes of x
+static inline __m128i reverse16(__m128i x)
+{
+	x = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+// reverse complement of 16 bases in upper case, fails if any of them is not one of "ACGTN" (either case)
+static inline bool revComp16(__m128i &x)
+{
+	__m128i u = _mm_and_si128(x, _mm_set1_epi8(char(0xDF)));
+	__m128i a = _mm_cmpeq_epi8(u, _mm_set1_epi8('A'));
+	__m128i c = _mm_cmpeq_epi8(u, _mm_set1_epi8('C'));
+	__m128i g = _mm_cmpeq_epi8(u, _mm_set1_epi8('G'));
+	__m128i t = _mm_cmpeq_epi8(u, _mm_set1_epi8('T'));
+	__m128i n = _mm_cmpeq_epi8(u, _mm_set1_epi8('N'));
+	if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(a, c), _mm_or_si128(g, t)), n)) != 0xFFFF){
+		return false;
+	}
+	x = _mm_or_si128(_mm_or_si128(_mm_and_si128(a, _mm_set1_epi8('T')), _mm_and_si128(c, _mm_set1_epi8('G'))),
+			_mm_or_si128(_mm_or_si128(_mm_and_si128(g, _mm_set1_epi8('C')), _mm_and_si128(t, _mm_set1_epi8('A'))),
+				_mm_and_si128(n, _mm_set1_epi8('N'))));
+	x = reverse16(x);
+	return true;
+}
+#endif
+
 const double MIN_PENALTY = 0.477121255;
 const double MEAN_PENALTY = 2.477121255;
 const double MAX_PENALTY = 4.477121255;
@@ -143,17 +186,20 @@ const double EPSILON = (MIN_PENALTY / 10);
 
 bool cElementSet::insert (const ELEMENT& val)
 {
-	pair<ELEMENT_SET::iterator,bool> ret;
-	ELEMENT_SET::iterator it = this->find(val);
-	if(it == this->end()){
-		ret = ELEMENT_SET::insert(val);
-		return ret.second;
+	// hits mostly come in ascending positions
+	if(this->empty() || (this->back().idx.pos < val.idx.pos)){
+		this->push_back(val);
+		return true;
+	}
+	iterator it = lower_bound(this->begin(), this->end(), val, ElementComparator());
+	if(it->idx.pos != val.idx.pos){
+		vector<ELEMENT>::insert(it, val);
+		return true;
 	}
 	if(val.score < it->score){
 		return true;
 	}
-	this->erase(it++);
-	ELEMENT_SET::insert(it, val);
+	*it = val;
 	return true;
 }
 
@@ -169,110 +215,112 @@ cAdapter::~cAdapter()
 
 void cAdapter::Init(char * seq, size_t sLen, TRIM_MODE trimMode)
 {
-	int i;
 	// construct sequence
 	this->len = (int(sLen) > MAX_ADAPTER_LEN) ? MAX_ADAPTER_LEN : sLen;
     skewer::gzstrncpy(sequence, seq, len);
 	this->trimMode = trimMode;
 
 	// construct mismatch bits
-	int code, code2;
-	uint64 bits;
-	for(code=0; code<CD_CNT; code++){
-		bits = 0;
-		for(i=int(len)-1; i>=0; i--){
-			code2 = codeMap[uchar(sequence[i])];
-			bits = (bits << 1) | chrVadp[code][code2];
-		}
-		matchBits[code] = ~bits;
-	}
+	initMatchBits(CD_CNT);
 }
 
 void cAdapter::Init2(char * seq, size_t sLen)
 {
 	int i;
 	// construct sequence
-	if(int(sLen) > MAX_ADAPTER_LEN){
-		// seq += (sLen - MAX_ADAPTER_LEN);
+	if(int(sLen) > MAX_READ_ADAPTER_LEN){
+		// seq += (sLen - MAX_READ_ADAPTER_LEN);
 		// the head instead of the tail should be used
-		this->len = MAX_ADAPTER_LEN;
+		this->len = MAX_READ_ADAPTER_LEN;
 	}
 	else{
 		this->len = sLen;
 	}
-	for(i=0; i<int(len); i++)
-		sequence[i] = character[complement[codeMap[uchar(seq[len-1-i])]]];
+	memcpy(sequence, seq, len);
+	cMatrix::RevComp(sequence, len);
 	sequence[len] = '\0';
 	this->trimMode = TRIM_TAIL;
 
 	// construct mismatch bits
-	int code, code2;
-	uint64 bits;
-	for(code=CD_BASIC_CNT-1; code>=0; code--){
-		bits = 0;
-		for(i=int(len)-1; i>=0; i--){
-			code2 = codeMap[uchar(sequence[i])];
-			bits = (bits << 1) | chrVadp[code][code2];
-		}
-		matchBits[code] = ~bits;
+	initMatchBits(CD_BASIC_CNT);
+	for(int code=CD_BASIC_CNT; code<CD_CNT; code++){
+		for(i=0; i<MAX_ADAPTER_WORDS; i++)
+			matchBits[code][i] = matchBits[CD_NONE][i];
 	}
-	for(bits=~bits,code=CD_BASIC_CNT; code<CD_CNT; code++){
-		matchBits[code] = bits;
+}
+
+// bit i of matchBits[code] is clear when code mismatches sequence[i]
+void cAdapter::initMatchBits(int nCodes)
+{
+	int i, k, code;
+	nWords = (len <= 64) ? 1 : ((len <= 128) ? 2 : MAX_ADAPTER_WORDS);
+	for(code=0; code<nCodes; code++){
+		for(k=0; k<MAX_ADAPTER_WORDS; k++)
+			matchBits[code][k] = ~0ULL;
+		for(i=0; i<int(len); i++){
+			if(chrVadp[code][codeMap[uchar(sequence[i])]])
+				matchBits[code][i >> 6] &= ~(1ULL << (i & 63));
+		}
 	}
 }
 
-inline void cAdapter::UPDATE_COLUMN(deque<ELEMENT> & queue, uint64 &d0bits, uint64 &lbits, uint64 &unbits, uint64 &dnbits, double &penal, double &dMaxPenalty, int &iMaxIndel)
+template<int W>
+inline void cAdapter::UPDATE_COLUMN(cElementRing & queue, cBits<W> &d0bits, cBits<W> &lbits, cBits<W> &unbits, cBits<W> &dnbits, double &penal, double &dMaxPenalty, int &iMaxIndel)
 {
-	int i;
+	int i, k;
 	double score;
-	uint64 bits = ~lbits | d0bits;
-	for(bits>>=1,i=1; i<int(queue.size())-1; i++,bits>>=1){
-		if((bits & 0x01) == 0){
-			if(cMatrix::bSensitive){
-				score = queue[i].score + (penal - cMatrix::dDelta);
-				if( (queue[i-1].score < score) && (queue[i-1].nIndel < iMaxIndel) ){
-					if( (queue[i+1].score < score) && (queue[i+1].nIndel < iMaxIndel) ){
-						if(queue[i-1].score < queue[i+1].score){
-							queue[i] = queue[i-1];
-							dnbits |= (1L << (i-1));
-						}
-						else{
-							queue[i] = queue[i+1];
-							unbits |= (1L << (i+1));
-						}
+	cBits<W> bits = ~lbits | d0bits;
+	int last = int(queue.size()) - 1;
+	// only the inner entries with a zero bit need updating, in ascending order
+	cBits<W> zeros = (last > 1) ? (~bits & cBits<W>::inner(last)) : cBits<W>::fill(0);
+	for(k=0; k<W; k++)
+	for(uint64 word = zeros.w[k]; word; word &= word - 1){
+		i = (k << 6) + __builtin_ctzll(word);
+		if(cMatrix::bSensitive){
+			score = queue[i].score + (penal - cMatrix::dDelta);
+			if( (queue[i-1].score < score) && (queue[i-1].nIndel < iMaxIndel) ){
+				if( (queue[i+1].score < score) && (queue[i+1].nIndel < iMaxIndel) ){
+					if(queue[i-1].score < queue[i+1].score){
+						queue[i] = queue[i-1];
+						dnbits.set(i-1);
 					}
 					else{
-						queue[i] = queue[i-1];
-						dnbits |= (1L << (i-1));
+						queue[i] = queue[i+1];
+						unbits.set(i+1);
 					}
-					queue[i].nIndel++;
 				}
 				else{
-					if( (queue[i+1].score < score) && (queue[i+1].nIndel < iMaxIndel) ){
-						queue[i] = queue[i+1];
-						unbits |= (1L << (i+1));
-						queue[i].nIndel++;
-					}
-					else{
-						queue[i].score = score;
-					}
+					queue[i] = queue[i-1];
+					dnbits.set(i-1);
 				}
-				queue[i].score += cMatrix::dDelta;
-			}
-			else{ // !cMatrix::bSensitive
-				queue[i].score += penal;
+				queue[i].nIndel++;
 			}
-			if(queue[i].score >= dMaxPenalty){
-				lbits &= ~(1L << i);
+			else{
+				if( (queue[i+1].score < score) && (queue[i+1].nIndel < iMaxIndel) ){
+					queue[i] = queue[i+1];
+					unbits.set(i+1);
+					queue[i].nIndel++;
+				}
+				else{
+					queue[i].score = score;
+				}
 			}
+			queue[i].score += cMatrix::dDelta;
+		}
+		else{ // !cMatrix::bSensitive
+			queue[i].score += penal;
+		}
+		if(queue[i].score >= dMaxPenalty){
+			lbits.reset(i);
 		}
 	}
 	if(queue.size() > 1){
-		if((bits & 0x01) == 0){
+		i = last;
+		if(!bits.test(i)){
 			if(cMatrix::bSensitive){
 				if( (queue[i-1].nIndel < iMaxIndel) && (queue[i-1].score + cMatrix::dDelta < queue[i].score + penal) ){
 					queue[i] = queue[i-1];
-					dnbits |= (1L << (i-1));
+					dnbits.set(i-1);
 					queue[i].score += cMatrix::dDelta;
 					queue[i].nIndel++;
 				}
@@ -284,7 +332,7 @@ inline void cAdapter::UPDATE_COLUMN(deque<ELEMENT> & queue, uint64 &d0bits, uint
 				queue[i].score += penal;
 			}
 			if(queue[i].score >= dMaxPenalty){
-				lbits &= ~(1L << i);
+				lbits.reset(i);
 			}
 		}
 		for(; i>0; i--){
@@ -295,6 +343,16 @@ inline void cAdapter::UPDATE_COLUMN(deque<ELEMENT> & queue, uint64 &d0bits, uint
 }
 
 bool cAdapter::align(char * read, size_t rLen, uchar * qual, size_t qLen, cElementSet &result, int bc, bool bBestAlign)
+{
+	switch(nWords){
+		case 1: return alignWords<1>(read, rLen, qual, qLen, result, bc, bBestAlign);
+		case 2: return alignWords<2>(read, rLen, qual, qLen, result, bc, bBestAlign);
+		default: return alignWords<MAX_ADAPTER_WORDS>(read, rLen, qual, qLen, result, bc, bBestAlign);
+	}
+}
+
+template<int W>
+bool cAdapter::alignWords(char * read, size_t rLen, uchar * qual, size_t qLen, cElementSet &result, int bc, bool bBestAlign)
 {
 	bool bDetermined = false;
 	ELEMENT elem;
@@ -303,10 +361,10 @@ bool cAdapter::align(char * read, size_t rLen, uchar * qual, size_t qLen, cEleme
 	int minK = bBestAlign ? ((cMatrix::iMinOverlap >= (int)(len - iMaxIndel + 1)) ? (int)(len - iMaxIndel + 1) : cMatrix::iMinOverlap) : 1;
 	double dMu = (bc >= 0) ? cMatrix::dMu : MIN_PENALTY;
 
-	deque<ELEMENT> queue;
+	cElementRing queue;
 	ELEMENT element;
 	double score;
-	uint64 legalBits = 0;
+	cBits<W> legalBits = cBits<W>::fill(0);
 	int i, j, jj;
 	element.idx.bc = bc + 1;
 	if(trimMode & TRIM_HEAD){
@@ -315,7 +373,7 @@ bool cAdapter::align(char * read, size_t rLen, uchar * qual, size_t qLen, cEleme
 			element.score = cMatrix::dPenaltyPerErr * i;
 			element.nIndel = 0;
 			queue.push_back(element);
-			legalBits = (legalBits << 1) | 1;
+			legalBits = legalBits.shl1(1);
 		}
 	}
 	else{
@@ -325,27 +383,27 @@ bool cAdapter::align(char * read, size_t rLen, uchar * qual, size_t qLen, cEleme
 			element.score = score;
 			element.nIndel = i;
 			queue.push_back(element);
-			legalBits = (legalBits << 1) | 1;
+			legalBits = legalBits.shl1(1);
 		}
 	}
 	element.nIndel = 0;
-	uint64 mbits, xbits, unbits, dnbits, d0bits;
-	unbits = dnbits = 0L;
+	cBits<W> mbits, xbits, unbits, dnbits, d0bits;
+	unbits = dnbits = cBits<W>::fill(0);
 	double penal;
 	for(j=0; j<int(rLen); j++){
 		jj = j;
-		mbits = matchBits[codeMap[uchar(read[jj])]];
+		mbits = cBits<W>::load(matchBits[codeMap[uchar(read[jj])]]);
 		penal = ((qLen > 0) ? cMatrix::penalty[qual[jj]] : dMu);
 
 		element.idx.pos = j;
-		element.score = ((mbits & 0x01) == 0) ? penal : 0;
+		element.score = !mbits.test(0) ? penal : 0;
 		queue.push_front(element);
 
 		xbits = mbits | unbits;
-		dnbits <<= 1;
-		unbits <<= 1;
+		dnbits = dnbits.shl1(0);
+		unbits = unbits.shl1(0);
 		d0bits = ((dnbits + (xbits & dnbits)) ^ dnbits) | xbits;
-		legalBits = (legalBits << 1) | 1;
+		legalBits = legalBits.shl1(1);
 
 		UPDATE_COLUMN(queue, d0bits, legalBits, unbits, dnbits, penal, dMaxPenalty, iMaxIndel);
 
@@ -501,25 +559,39 @@ bool cMatrix::CalcRevCompScore(char * seq, char * seq2, int len, uchar * qual, u
 		return true;
 	}
 	score = 0.0;
-	for(int i=0; i<len; i++){
-		code = codeMap[uchar(seq[i])];
-		code2 = complement[codeMap[uchar(seq2[len-1-i])]];
-		penal = scoring[code][code2];
-		if(penal > 0.0){
-			if(qLen > 0){
-				if(cMatrix::penalty[qual[i]] <= cMatrix::penalty[qual2[len-1-i]]){
-					penal *= cMatrix::penalty[qual[i]];
+	for(int i=0; i<len; i+=16){
+		int mask = (len - i >= 16) ? 0xFFFF : ((1 << (len - i)) - 1); // positions that may mismatch
+#ifdef __SSE2__
+		if(len - i >= 16){
+			// identical upper-case bases of "ACGTN" score 0, skip them
+			__m128i rc = _mm_loadu_si128((const __m128i *)(seq2 + len - 16 - i));
+			if(revComp16(rc)){
+				__m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i *)(seq + i)), _mm_set1_epi8(char(0xDF)));
+				mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, rc)) & 0xFFFF;
+			}
+		}
+#endif
+		for(; mask!=0; mask&=(mask-1)){
+			int j = i + __builtin_ctz(mask);
+			code = codeMap[uchar(seq[j])];
+			code2 = complement[codeMap[uchar(seq2[len-1-j])]];
+			penal = scoring[code][code2];
+			if(penal > 0.0){
+				if(qLen > 0){
+					if(cMatrix::penalty[qual[j]] <= cMatrix::penalty[qual2[len-1-j]]){
+						penal *= cMatrix::penalty[qual[j]];
+					}
+					else{
+						penal *= cMatrix::penalty[qual2[len-1-j]];
+					}
 				}
 				else{
-					penal *= cMatrix::penalty[qual2[len-1-i]];
+					penal *= dMu;
+				}
+				score += penal;
+				if(score > dMaxPenalty){
+					return false;
 				}
-			}
-			else{
-				penal *= dMu;
-			}
-			score += penal;
-			if(score > dMaxPenalty){
-				return false;
 			}
 		}
 	}
@@ -527,17 +599,29 @@ bool cMatrix::CalcRevCompScore(char * seq, char * seq2, int len, uchar * qual, u
 	return true;
 }
 
-string cMatrix::GetRevComp(char * seq, int len)
+void cMatrix::RevComp(char * seq, int len)
 {
-	char sequence[MAX_ADAPTER_LEN+1];
-	if(len > MAX_ADAPTER_LEN){
-		seq += (len - MAX_ADAPTER_LEN);
-		len = MAX_ADAPTER_LEN;
-	}
-    for(int i=0; i<int(len); i++) 
-        sequence[i] = character[complement[codeMap[uchar(seq[len-1-i])]]];
-    sequence[len] = '\0';
-	return string(sequence);
+	int i = 0, j = len; // seq[i, j) is still to be done
+#ifdef __SSE2__
+	// swap 16 bases from both ends at a time
+	for(; j-i>=32; i+=16, j-=16){
+		__m128i head = _mm_loadu_si128((const __m128i *)(seq + i));
+		__m128i tail = _mm_loadu_si128((const __m128i *)(seq + j - 16));
+		if(!revComp16(head) || !revComp16(tail))
+			break;
+		_mm_storeu_si128((__m128i *)(seq + i), tail);
+		_mm_storeu_si128((__m128i *)(seq + j - 16), head);
+	}
+#endif
+	char chr;
+	for(j--; i<j; i++, j--){
+		chr = revComp.chr[uchar(seq[i])];
+		seq[i] = revComp.chr[uchar(seq[j])];
+		seq[j] = chr;
+	}
+	if(i == j){
+		seq[i] = revComp.chr[uchar(seq[i])];
+	}
 }
 
 //// public functions
@@ -629,11 +713,26 @@ void cMatrix::InitBarcodes(deque<cAdapter> & fw_adapters, int iCutF, deque<cAdap
 
 bool cMatrix::isBlurry(char * seq, size_t len)
 {
-	size_t u;
+	size_t u = 0;
 	int iMaxBlurry = ceil(cMatrix::dEpsilon * len);
 	int iBlurry = 0;
-	for(u=0; u<len; u++){
-		if(blurry[int(seq[u])]){
+#ifdef __SSE2__
+	// a base is clear when its lower case is one of "acgtu", see blurry[]
+	const __m128i lower = _mm_set1_epi8(0x20);
+	const __m128i a = _mm_set1_epi8('a'), c = _mm_set1_epi8('c'), g = _mm_set1_epi8('g');
+	const __m128i t = _mm_set1_epi8('t'), uu = _mm_set1_epi8('u');
+	for(; u+16<=len; u+=16){
+		__m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i *)(seq + u)), lower);
+		__m128i clear = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, a), _mm_cmpeq_epi8(x, c)),
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, g), _mm_cmpeq_epi8(x, t)), _mm_cmpeq_epi8(x, uu)));
+		iBlurry += 16 - __builtin_popcount(_mm_movemask_epi8(clear));
+		if(iBlurry > iMaxBlurry){
+			return true;
+		}
+	}
+#endif
+	for(; u<len; u++){
+		if(blurry[uchar(seq[u])]){
 			if(++iBlurry > iMaxBlurry){
 				return true;
 			}
@@ -644,10 +743,17 @@ bool cMatrix::isBlurry(char * seq, size_t len)
 
 bool cMatrix::checkQualities(uchar * quals, size_t len, int minQual)
 {
-	size_t u;
+	size_t u = 0;
 	if(len == 0) return true;
 	int total = 0;
-	for(u=0; u<len; u++){
+#ifdef __SSE2__
+	__m128i sum = _mm_setzero_si128();
+	for(; u+16<=len; u+=16){
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(quals + u)), _mm_setzero_si128()));
+	}
+	total = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+	for(; u<len; u++){
 		total += quals[u];
 	}   
 	return (double(total) / len) >= minQual;
@@ -655,8 +761,22 @@ bool cMatrix::checkQualities(uchar * quals, size_t len, int minQual)
 
 int cMatrix::trimByQuality(uchar * quals, size_t len, int minQual)
 {
-	int i;
-	for(i=(int)len-1; i>=0; i--){
+	int i = (int)len - 1;
+#ifdef __SSE2__
+	// 16 qualities at a time from the 3' end, q >= minQual iff max(q, minQual) == q
+	if( (minQual > 0) && (minQual <= 255) ){
+		const __m128i vMin = _mm_set1_epi8(char(minQual));
+		int mask;
+		for(; i>=15; i-=16){
+			__m128i q = _mm_loadu_si128((const __m128i *)(quals + i - 15));
+			mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(q, vMin), q));
+			if(mask != 0){
+				return (i - 15) + (32 - __builtin_clz(mask));
+			}
+		}
+	}
+#endif
+	for(; i>=0; i--){
 		if(quals[i] >= minQual)
 			break;
 	}
@@ -667,7 +787,8 @@ INDEX cMatrix::findAdapter(char * read, size_t rLen, uchar * qual, size_t qLen)
 {
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result;
+	static thread_local cElementSet result;
+	result.clear();
 	double maxScore = -1;
 	INDEX index;
 	index.pos = int(rLen);
@@ -685,11 +806,39 @@ INDEX cMatrix::findAdapter(char * read, size_t rLen, uchar * qual, size_t qLen)
 	return index;
 }
 
+// findAdapter for a block of n reads, one adapter at a time over the whole block
+void cMatrix::findAdapterBatch(char ** reads, size_t * rLens, uchar ** quals, size_t * qLens, int n, INDEX * indices)
+{
+	deque<cAdapter>::iterator it_adapter;
+	cAdapter * pAdapter;
+	static thread_local cElementSet result;
+	static thread_local vector<double> maxScores;
+	result.clear();
+	maxScores.assign(n, -1);
+	int i, k;
+	for(k=0; k<n; k++){
+		indices[k].pos = int(rLens[k]);
+		indices[k].bc = 0;
+	}
+	for(i=0,it_adapter=firstAdapters.begin(); it_adapter!=firstAdapters.end(); it_adapter++,i++){
+		pAdapter = &(*it_adapter);
+		for(k=0; k<n; k++){
+			if(pAdapter->align(reads[k], rLens[k], quals[k], qLens[k], result, i)){
+				if(result.begin()->score > maxScores[k]){
+					indices[k] = result.begin()->idx;
+					maxScores[k] = result.begin()->score;
+				}
+			}
+		}
+	}
+}
+
 INDEX cMatrix::findAdapter2(char * read, size_t rLen, uchar * qual, size_t qLen)
 {
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result;
+	static thread_local cElementSet result;
+	result.clear();
 	double maxScore = -1;
 	INDEX index;
 	index.pos = int(rLen);
@@ -712,7 +861,8 @@ INDEX cMatrix::findJuncAdapter(char * read, size_t rLen, uchar * qual, size_t qL
 {
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result;
+	static thread_local cElementSet result;
+	result.clear();
 	double maxScore = -1;
 	INDEX index;
 	index.pos = int(rLen);
@@ -734,7 +884,9 @@ bool cMatrix::findAdapterWithPE(char * read, char * read2, size_t rLen, size_t r
 {
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result, result2;
+	static thread_local cElementSet result, result2;
+	result.clear();
+	result2.clear();
 	index.pos = int(rLen);
 	index.bc = -1;
 	index2.pos = int(rLen2);
@@ -865,14 +1017,15 @@ int cMatrix::findAdaptersInARead(char * read, size_t rLen, uchar * qual, size_t
 {
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result;
+	static thread_local cElementSet result;
+	result.clear();
 	index.pos = int(rLen);
 	index.bc = -1;
 	int i;
 	size_t nLen;
 	double maxScore = -1;
 	int flag = 0;
-	deque<ELEMENT>::iterator it_element, it_element2;
+	vector<ELEMENT>::iterator it_element, it_element2;
 	for(i=0,it_adapter=firstAdapters.begin(); it_adapter!=firstAdapters.end(); it_adapter++,i++){
 		pAdapter = &(*it_adapter);
 		nLen = (pAdapter->len < rLen ? pAdapter->len : rLen);
@@ -911,13 +1064,18 @@ char * read2, size_t rLen2, uchar * qual2, size_t qLen2, INDEX &index, INDEX &in
 	int bc = -1;
 	deque<cAdapter>::iterator it_adapter;
 	cAdapter * pAdapter;
-	cElementSet result;
-	deque<ELEMENT> result1, result2, result3, result4;
+	static thread_local cElementSet result;
+	result.clear();
+	static thread_local vector<ELEMENT> result1, result2, result3, result4;
+	result1.clear();
+	result2.clear();
+	result3.clear();
+	result4.clear();
 	index.pos = index2.pos = int(rLen);
 	index.bc = index2.bc = 0;
 	int i;
 	size_t nLen;
-	deque<ELEMENT>::iterator it_element, it_element2;
+	vector<ELEMENT>::iterator it_element, it_element2;
 	for(i=0,it_adapter=firstAdapters.begin(); it_adapter!=firstAdapters.end(); it_adapter++,i++){
 		pAdapter = &(*it_adapter);
 		nLen = (pAdapter->len < rLen ? pAdapter->len : rLen);
@@ -1066,15 +1224,13 @@ bool cMatrix::PrepareBarcode(char * barcodeSeq, int bcIdx, char * seq, int len,
 INDEX cMatrix::mergePE(char * read, char * read2, size_t rLen, uchar * qual, uchar * qual2, size_t qLen, size_t startPos, size_t jLen)
 {
 	INDEX index;
-	cElementSet result;
+	static thread_local cElementSet result;
+	result.clear();
 	cAdapter adapter;
 	double score;
 	int pos, clen;
 	bool bRevComplement = false;
 	size_t endPos, eLen;
-	char chr;
-	uchar uchr;
-	int i;
 	index.pos = int(rLen);
 	index.bc = 0;
 	adapter.Init2(read2, rLen);
@@ -1095,23 +1251,12 @@ INDEX cMatrix::mergePE(char * read, char * read2, size_t rLen, uchar * qual, uch
 		else{
 			eLen = rLen - (endPos + clen);
 			index.pos += eLen;
-			for(i=eLen/2; i>=0; i--){ //reverse
-				chr = read2[endPos + i];
-				read2[endPos + i] = read2[endPos + eLen - 1 - i];
-				read2[endPos + eLen - 1 - i] = chr;
-			}
-			for(i=0; i<(int)eLen; i++){
-				read2[startPos + i] = character[complement[codeMap[uchar(read2[endPos + i])]]];
-			}
+			// reverse complement the tail in place, then move it down to startPos
+			RevComp(read2 + endPos, eLen);
+			memmove(read2 + startPos, read2 + endPos, eLen);
 			if(qLen > 0){
-				for(i=eLen/2; i>=0; i--){ //reverse
-					uchr = qual2[endPos + i];
-					qual2[endPos + i] = qual2[endPos + eLen - 1 -i];
-					qual2[endPos + eLen - 1 - i] = uchr;
-				}
-				for(i=0; i<(int)eLen; i++){
-					qual2[startPos + i] = qual2[endPos + i];
-				}
+				reverse(qual2 + endPos, qual2 + endPos + eLen);
+				memmove(qual2 + startPos, qual2 + endPos, eLen);
 			}
 		}
 	}
@@ -1144,7 +1289,26 @@ bool cMatrix::combinePairSeqs(char * read, char * read2, int len, int len2, ucha
 	if(minQLen < len){
 		return false;
 	}
-	for(int i=0; i<len; i++){
+	int i = 0;
+#ifdef __SSE2__
+	// take the base of read2 where its quality is higher and the bases differ
+	for(; i+16<=len; i+=16){
+		__m128i rc = _mm_loadu_si128((const __m128i *)(read2 + len - 16 - i));
+		if(!revComp16(rc))
+			break;
+		__m128i x = _mm_loadu_si128((const __m128i *)(read + i));
+		__m128i q = _mm_loadu_si128((const __m128i *)(qual + i));
+		__m128i q2 = reverse16(_mm_loadu_si128((const __m128i *)(qual2 + len - 16 - i)));
+		__m128i qMax = _mm_max_epu8(q, q2);
+		__m128i u = _mm_and_si128(x, _mm_set1_epi8(char(0xDF)));
+		__m128i sameCode = _mm_or_si128(_mm_cmpeq_epi8(u, rc), // 'U' is coded as 'T'
+				_mm_and_si128(_mm_cmpeq_epi8(u, _mm_set1_epi8('U')), _mm_cmpeq_epi8(rc, _mm_set1_epi8('T'))));
+		__m128i same = _mm_or_si128(_mm_cmpeq_epi8(qMax, q), sameCode);
+		_mm_storeu_si128((__m128i *)(qual + i), qMax);
+		_mm_storeu_si128((__m128i *)(read + i), _mm_or_si128(_mm_and_si128(same, x), _mm_andnot_si128(same, rc)));
+	}
+#endif
+	for(; i<len; i++){
 		code = codeMap[uchar(read[i])];
 		code2 = complement[codeMap[uchar(read2[len-1-i])]];
 		if(qual2[len-1-i] > qual[i]){
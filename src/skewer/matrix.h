@@ -34,7 +34,6 @@
 #include <stdlib.h>
 #include <deque>
 #include <vector>
-#include <set>
 #include <string>
 #include "common.h"
 
@@ -54,9 +53,75 @@ public:
 	}
 };
 
-typedef set<ELEMENT, ElementComparator> ELEMENT_SET;
+// fixed-capacity ring buffer for the active DP column of cAdapter::align,
+// element 0 is the front (the latest column entry)
+class cElementRing
+{
+	static const int CAPACITY = MAX_ADAPTER_LEN; // a power of 2
+	ELEMENT elements[CAPACITY];
+	int head;
+	int count;
+
+public:
+	cElementRing() : head(0), count(0) {}
+	size_t size() const { return count; }
+	bool empty() const { return (count == 0); }
+	void clear() { head = count = 0; }
+	ELEMENT & operator[](int i) { return elements[(head + i) & (CAPACITY - 1)]; }
+	ELEMENT & back() { return elements[(head + count - 1) & (CAPACITY - 1)]; }
+	void push_front(const ELEMENT &elem) { head = (head - 1) & (CAPACITY - 1); elements[head] = elem; count++; }
+	void push_back(const ELEMENT &elem) { elements[(head + count) & (CAPACITY - 1)] = elem; count++; }
+	void pop_back() { count--; }
+};
+
+// bit-vector of W 64-bit words for the k-difference recurrence, bit i of the
+// vector is bit (i & 63) of w[i >> 6]; carries and shifts cross word borders
+template<int W>
+struct cBits
+{
+	uint64 w[W];
+
+	static cBits fill(uint64 v) { cBits r; for(int k=0; k<W; k++) r.w[k] = v; return r; }
+	static cBits load(const uint64 * p) { cBits r; for(int k=0; k<W; k++) r.w[k] = p[k]; return r; }
+	bool test(int i) const { return (w[i >> 6] >> (i & 63)) & 0x01; }
+	void set(int i) { w[i >> 6] |= (1ULL << (i & 63)); }
+	void reset(int i) { w[i >> 6] &= ~(1ULL << (i & 63)); }
+	// bits 1 .. last-1
+	static cBits inner(int last) {
+		cBits r;
+		for(int k=0; k<W; k++){
+			int n = last - (k << 6); // bits of this word below last
+			r.w[k] = (n >= 64) ? ~0ULL : ((n > 0) ? ((1ULL << n) - 1) : 0);
+		}
+		r.w[0] &= ~1ULL;
+		return r;
+	}
+	// (*this << 1) | in
+	cBits shl1(uint64 in) const {
+		cBits r;
+		for(int k=W-1; k>0; k--) r.w[k] = (w[k] << 1) | (w[k-1] >> 63);
+		r.w[0] = (w[0] << 1) | in;
+		return r;
+	}
+	cBits operator~() const { cBits r; for(int k=0; k<W; k++) r.w[k] = ~w[k]; return r; }
+	cBits operator|(const cBits &b) const { cBits r; for(int k=0; k<W; k++) r.w[k] = w[k] | b.w[k]; return r; }
+	cBits operator&(const cBits &b) const { cBits r; for(int k=0; k<W; k++) r.w[k] = w[k] & b.w[k]; return r; }
+	cBits operator^(const cBits &b) const { cBits r; for(int k=0; k<W; k++) r.w[k] = w[k] ^ b.w[k]; return r; }
+	cBits operator+(const cBits &b) const {
+		cBits r;
+		uint64 carry = 0;
+		for(int k=0; k<W; k++){
+			uint64 s = w[k] + b.w[k];
+			r.w[k] = s + carry;
+			carry = (s < w[k]) | (r.w[k] < s);
+		}
+		return r;
+	}
+	cBits & operator&=(const cBits &b) { for(int k=0; k<W; k++) w[k] &= b.w[k]; return *this; }
+};
 
-class cElementSet : public ELEMENT_SET
+// candidate hits kept sorted by position in a flat buffer, one per position
+class cElementSet : public vector<ELEMENT>
 {
 public:
 	bool insert(const ELEMENT& val);
@@ -89,13 +154,18 @@ class cAdapter
 	char barcode[MAX_ADAPTER_LEN+1];
 	char primer[MAX_ADAPTER_LEN+1];
 	bool masked[MAX_ADAPTER_LEN+1];
-	inline void UPDATE_COLUMN(deque<ELEMENT> & queue, uint64 &d0bits, uint64 &lbits, uint64 &unbits, uint64 &dnbits, double &penal, double &dMaxPenalty, int &iMaxIndel);
+	template<int W>
+	inline void UPDATE_COLUMN(cElementRing & queue, cBits<W> &d0bits, cBits<W> &lbits, cBits<W> &unbits, cBits<W> &dnbits, double &penal, double &dMaxPenalty, int &iMaxIndel);
+	void initMatchBits(int nCodes);
+	template<int W>
+	bool alignWords(char * read, size_t rLen, uchar * qual, size_t qLen, cElementSet &result, int bc, bool bBestAlign);
 
 public:
 	size_t len;
 	TRIM_MODE trimMode;
 	bool bBestAlign;
-	uint64 matchBits[CD_CNT];
+	int nWords; // 64-bit words of the bit-vectors, picked from len
+	uint64 matchBits[CD_CNT][MAX_ADAPTER_WORDS];
     bool bIsLowComplexity;
 
 public:
@@ -153,7 +223,6 @@ public:
 
 private:
 	static bool CalcRevCompScore(char * seq, char * seq2, int len, uchar * qual, uchar * qual2, size_t qLen, double &score);
-	static string GetRevComp(char * seq, int len);
 
 public:
 	static void InitParameters(enum TRIM_MODE trimMode, double dEpsilon, double dEpsilonIndel, int baseQual, bool bShareAdapter, bool bIsLowComplexity);
@@ -162,11 +231,13 @@ public:
 	static void CalculateIndices(vector< vector<bool> > &bMatrix, int nRow, int nCol);
 	static void InitBarcodes(deque<cAdapter> & fw_primers, int iCutF, deque<cAdapter> & rv_primers, int iCutR);
 
+	static void RevComp(char * seq, int len);
 	static bool isBlurry(char * seq, size_t len);
 	static bool checkQualities(uchar * quals, size_t len, int minQual);
 	static int trimByQuality(uchar * quals, size_t len, int minQual);
 
 	static INDEX findAdapter(char * read, size_t rLen, uchar * qual, size_t qLen);
+	static void findAdapterBatch(char ** reads, size_t * rLens, uchar ** quals, size_t * qLens, int n, INDEX * indices);
 	static INDEX findAdapter2(char * read, size_t rLen, uchar * qual, size_t qLen);
 	static INDEX findJuncAdapter(char * read, size_t rLen, uchar * qual, size_t qLen);
 
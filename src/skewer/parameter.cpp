@@ -157,6 +157,7 @@ cParameter::cParameter()
 	minEndQual = 0;
 	minK = 5;
 	nThreads = 1;
+	nBufferMB = 256;
 
 	iCutF = iCutR = 0;
 	bCutTail = false;
@@ -379,6 +380,7 @@ void cParameter::PrintUsage(const char * program, FILE * fp)
 	fprintf(fp, " Miscellaneous:\n");
 	fprintf(fp, "          -i, --intelligent     For mate-pair mode, whether to redistribute reads based on junction information; (no)\n");
 	fprintf(fp, "          -t, --threads <int>   Number of concurrent threads [1, 32]; (1)\n");
+	fprintf(fp, "          -B, --buffer <int>    Maximum memory in MB for the reads being processed [1, inf); (256)\n");
 	fprintf(fp, "\nEXAMPLES:\n");
 	fprintf(fp, "          %s -Q 9 -t 2 -x adapters.fa sample.fastq -o trimmed\n", program);
 	fprintf(fp, "          %s -x %s -q 3 sample-pair1.fq.gz sample-pair2.fq.gz\n", program, ILLUMINA_ADAPTER_PREFIX);
@@ -560,11 +562,14 @@ void cParameter::printOpt(FILE * fp, bool bLeadingRtn)
 	if(nThreads > 1){
 		fprintf(fp, "-- number of concurrent threads (-t):\t%d\n", nThreads);
 	}
+	if(nBufferMB != 256){
+		fprintf(fp, "-- maximum memory for reads in process (-B):\t%d MB\n", nBufferMB);
+	}
 }
 
 int cParameter::GetOpt(int argc, const char *argv[], char * errMsg)
 {
-	const char *options = "x:y:j:m:r:d:q:l:L:M:nuf:bc:e#o:z1Q:k:t:i*vhAXNC";
+	const char *options = "x:y:j:m:r:d:q:l:L:M:nuf:bc:e#o:z1Q:k:t:B:i*vhAXNC";
 	OPTION_ITEM longOptions[] = {
 		{"barcode", 'b'},
 		{"mode", 'm'},
@@ -575,6 +580,7 @@ int cParameter::GetOpt(int argc, const char *argv[], char * errMsg)
 		{"matrix", 'M'},
 		{"output", 'o'},
 		{"threads", 't'},
+		{"buffer", 'B'},
 		{"format", 'f'},
 		{"stdout", '1'},
 		{"compress", 'z'},
@@ -815,6 +821,14 @@ int cParameter::GetOpt(int argc, const char *argv[], char * errMsg)
 			if(nThreads < 1) nThreads = 1;
 			else if(nThreads > 32) nThreads = 32;
 			break;
+		case 'B':
+			if(argv[i][0] < '0' || argv[i][0] > '9'){
+				iRet = -3;
+				break;
+			}
+			nBufferMB = atoi(argv[i]);
+			if(nBufferMB < 1) nBufferMB = 1;
+			break;
 		case 'b':
 			bBarcode = true;
 			break;
@@ -117,6 +117,7 @@ public:
 	COMPRESS_FORMAT outputFormat;
 	double epsilon, delta;
 	int minLen, maxLen, minAverageQual, minEndQual, nThreads;
+	int nBufferMB; // cap of the record buffer
 	int minK;
 	int iCutF, iCutR;
 	bool bCutTail;